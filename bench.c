@@ -0,0 +1,382 @@
+/*
+ * bench.c
+ *
+ * Load generator for the verifier: worker threads take requests in batches
+ * from a shared sequence and report throughput and the latency distribution.
+ *
+ * Requests arrive at a fixed rate (-R, open loop) or as fast as the workers
+ * take them (closed loop). Latency runs from the arrival of a request to the
+ * end of its batch, so queueing and batching delays are both included.
+ * Requests use a hot key with probability -k, else one of the cold keys, and
+ * carry a corrupted signature with probability -i. With -x, hot keys are
+ * verified through their expanded keys. With -a all requests form one bundle
+ * that is verified all or nothing: the first bad signature stops all workers.
+ * -T loads the autotuner profile from a file, or measures and writes it, and
+ * prints it before the run.
+ *
+ * With -c, a share of the requests is latency-critical and the rest is bulk,
+ * and they go through the library's two-class queue (qdsa_sched_*, open loop
+ * only): the main thread submits each request at its arrival time and the
+ * workers serve the queue. A latency request is served alone as soon as a
+ * worker is free, before any bulk work; -r workers serve only latency
+ * requests. Bulk requests are taken in batches of up to -b, grouped by key,
+ * so each key of a batch is decompressed once; -x does not apply. -p pins
+ * worker w to core w, so the reserved workers own their cores. Queue delay
+ * (arrival to start of service) and latency are reported per class.
+ */
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "supp.h"
+#include "qdsv.h"
+
+#define NHOT 4     // hot keys
+#define NMSG 16    // messages signed per hot key
+#define NCOLD 192  // cold keys, one message each
+#define NITEM (NHOT * NMSG + NCOLD)
+
+typedef struct {
+   uint8_t _align4 sig[64];
+   uint8_t _align4 pk[32];
+   uint8_t _align4 msg[32];
+} item;
+
+typedef struct {
+   uint16_t it;  // item index
+   uint8_t bad;  // corrupted signature
+   uint8_t cls;  // CLS_*
+} request;
+
+enum { CLS_LAT = QDSA_LAT, CLS_BULK = QDSA_BULK, CLS_NUM };
+
+item items[NITEM];
+uint8_t _align4 hot_xpk[NHOT][QDSA_XPK_LEN];
+request *req;
+uint64_t *lat;  // ns per request
+uint nreq, batch, use_xpk, use_bundle;
+double rate;    // requests per second, 0 for closed loop
+uint64_t t_start;
+uint next_req;  // shared, atomic
+uint errors;    // shared, atomic
+qdsa_bundle bundle;  // shared with -a
+uint8_t (*bsig)[64], (*bpk)[32], (*bmsg)[32];
+uint64_t *qdel;            // ns per request, with -c
+uint *cls_req[CLS_NUM];    // request indices of each class, in arrival order
+uint cls_n[CLS_NUM];
+uint reserved, pin;
+qdsa_sched sched;          // with -c
+uint sched_done;           // shared, atomic: all requests submitted
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t arrival(uint i)
+{
+   return t_start + (uint64_t)(i / rate * 1e9);
+}
+
+static int verify_one(const request *r)
+{
+   const item *x = &items[r->it];
+   uint8_t _align4 sig[64];
+
+   wam_copy(sig, x->sig, 64);
+   if (r->bad) sig[32 + r->it % 31] ^= 0x10;
+   if (use_xpk && r->it < NHOT * NMSG)
+      return qdsa_verify_xpk(sig, hot_xpk[r->it / NMSG], x->msg);
+   return qdsa_verify(sig, x->pk, x->msg);
+}
+
+static void *worker(void *arg)
+{
+   uint64_t t0, t1;
+
+   for (;;) {
+      uint i = __atomic_fetch_add(&next_req, batch, __ATOMIC_RELAXED);
+      if (i >= nreq) break;
+      uint n = nreq - i < batch ? nreq - i : batch;
+
+      // A batch starts once its last request has arrived.
+      t0 = now_ns();
+      if (rate > 0) {
+         t1 = arrival(i + n - 1);
+         while (t0 < t1)
+            t0 = now_ns();
+      }
+      if (use_bundle)
+         qdsa_verify_bundle(&bundle, bsig, bpk, bmsg, i, i + n);
+      for (uint j = 0; j < n && !use_bundle; j++) {
+         int res = verify_one(&req[i + j]);
+         if ((res == 0) == req[i + j].bad)
+            __atomic_fetch_add(&errors, 1, __ATOMIC_RELAXED);
+      }
+      t1 = now_ns();
+      for (uint j = 0; j < n; j++)
+         lat[i + j] = t1 - (rate > 0 ? arrival(i + j) : t0);
+   }
+   return arg;
+}
+
+/* Serve the two-class queue until the producer is done and it is empty. */
+static void *sched_worker(void *arg)
+{
+   uint w = (uint)(uintptr_t)arg;
+
+   if (pin) {
+      cpu_set_t cs;
+      CPU_ZERO(&cs);
+      CPU_SET(w, &cs);
+      pthread_setaffinity_np(pthread_self(), sizeof(cs), &cs);
+   }
+   for (;;) {
+      uint d = __atomic_load_n(&sched_done, __ATOMIC_ACQUIRE);
+      if (qdsa_sched_work(&sched, w)) continue;
+      if (d) break;
+      sched_yield();
+   }
+   return arg;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+   return (x > y) - (x < y);
+}
+
+/* Percentiles of v over the requests of class c, in us. */
+static void class_pct(const char *name, const uint64_t *v, int c)
+{
+   uint n = cls_n[c];
+   uint64_t *s = malloc(n * sizeof(uint64_t));
+
+   for (uint i = 0; i < n; i++)
+      s[i] = v[cls_req[c][i]];
+   qsort(s, n, sizeof(uint64_t), cmp_u64);
+   printf("  %-13s p50 %9.1f  p99 %9.1f  p999 %9.1f  max %9.1f\n", name,
+      s[n / 2] / 1e3, s[(uint64_t)n * 99 / 100] / 1e3,
+      s[(uint64_t)n * 999 / 1000] / 1e3, s[n - 1] / 1e3);
+   free(s);
+}
+
+static void setup(int devrand)
+{
+   uint8_t _align4 seed[32], sk[64];
+   int n = 0;
+
+   for (int k = 0; k < NHOT; k++) {
+      n += read(devrand, seed, 32);
+      qdsa_keypair(items[k * NMSG].pk, sk, seed);
+      qdsa_pk_expand(hot_xpk[k], items[k * NMSG].pk);
+      for (int m = 0; m < NMSG; m++) {
+         item *x = &items[k * NMSG + m];
+         wam_copy(x->pk, items[k * NMSG].pk, 32);
+         n += read(devrand, x->msg, 32);
+         qdsa_sign(x->sig, x->msg, x->pk, sk);
+      }
+   }
+   for (int c = NHOT * NMSG; c < NITEM; c++) {
+      n += read(devrand, seed, 32);
+      n += read(devrand, items[c].msg, 32);
+      qdsa_keypair(items[c].pk, sk, seed);
+      qdsa_sign(items[c].sig, items[c].msg, items[c].pk, sk);
+   }
+}
+
+static void usage(void)
+{
+   printf("bench [-t threads] [-b batch] [-n requests] [-R rate/s]\n"
+          "      [-k hot-key ratio] [-i invalid ratio] [-x] [-s seed]\n"
+          "      [-a] [-T tune profile]\n"
+          "      [-c latency ratio [-r reserved workers] [-p]]\n");
+}
+
+int main(int argc, char **argv)
+{
+   uint nthr = 1, rseed = 1;
+   double hot = 0.5, bad = 0.0, lfrac = -1;
+   const char *prof = NULL;
+   int opt;
+
+   nreq = 2000;
+   batch = 1;
+   while ((opt = getopt(argc, argv, "t:b:n:R:k:i:xas:T:c:r:ph")) != -1) {
+      switch (opt) {
+      case 't': nthr = atoi(optarg); break;
+      case 'b': batch = atoi(optarg); break;
+      case 'n': nreq = atoi(optarg); break;
+      case 'R': rate = atof(optarg); break;
+      case 'k': hot = atof(optarg); break;
+      case 'i': bad = atof(optarg); break;
+      case 'x': use_xpk = 1; break;
+      case 'a': use_bundle = 1; break;
+      case 's': rseed = atoi(optarg); break;
+      case 'T': prof = optarg; break;
+      case 'c': lfrac = atof(optarg); break;
+      case 'r': reserved = atoi(optarg); break;
+      case 'p': pin = 1; break;
+      default: usage(); return opt != 'h';
+      }
+   }
+   if (nthr < 1 || batch < 1 || nreq < 1
+      || (lfrac >= 0 && (rate <= 0 || use_bundle || reserved >= nthr))) {
+      usage();
+      return 1;
+   }
+
+   if (prof) {
+      qdsa_tune t;
+      if (qdsa_tune_init(prof)) printf("Can't write %s\n", prof);
+      qdsa_tune_get(&t);
+      qdsa_tune_save(&t, "-");
+   }
+
+   int devrand = open("/dev/urandom", O_RDONLY);
+   if (devrand < 0) {
+      printf("Can't open /dev/urandom\n");
+      return -1;
+   }
+   setup(devrand);
+   close(devrand);
+
+   req = malloc(nreq * sizeof(request));
+   lat = malloc(nreq * sizeof(uint64_t));
+   pthread_t *thr = malloc(nthr * sizeof(pthread_t));
+   srand(rseed);
+   for (uint i = 0; i < nreq; i++) {
+      if (rand() < hot * RAND_MAX)
+         req[i].it = rand() % (NHOT * NMSG);
+      else
+         req[i].it = NHOT * NMSG + rand() % NCOLD;
+      req[i].bad = rand() < bad * RAND_MAX;
+      req[i].cls = rand() < lfrac * RAND_MAX ? CLS_LAT : CLS_BULK;
+   }
+   if (lfrac >= 0) {
+      qdel = malloc(nreq * sizeof(uint64_t));
+      for (int c = 0; c < CLS_NUM; c++)
+         cls_req[c] = malloc(nreq * sizeof(uint));
+      for (uint i = 0; i < nreq; i++)
+         cls_req[req[i].cls][cls_n[req[i].cls]++] = i;
+   }
+   if (use_bundle || lfrac >= 0) {
+      bsig = malloc(nreq * 64);
+      bpk = malloc(nreq * 32);
+      bmsg = malloc(nreq * 32);
+      for (uint i = 0; i < nreq; i++) {
+         const item *x = &items[req[i].it];
+         wam_copy(bsig[i], x->sig, 64);
+         if (req[i].bad) bsig[i][32 + req[i].it % 31] ^= 0x10;
+         wam_copy(bpk[i], x->pk, 32);
+         wam_copy(bmsg[i], x->msg, 32);
+      }
+      qdsa_bundle_init(&bundle);
+   }
+   qdsa_req *sreq = NULL, **ring = NULL;
+   if (qdel) {
+      uint cap = 1;
+      while (cap < nreq)
+         cap *= 2;
+      sreq = calloc(nreq, sizeof(qdsa_req));
+      ring = malloc(2 * cap * sizeof(qdsa_req *));
+      qdsa_sched_init(&sched, ring, cap, batch, reserved);
+      for (uint i = 0; i < nreq; i++) {
+         sreq[i].sig = bsig[i];
+         sreq[i].pk = bpk[i];
+         sreq[i].msg = bmsg[i];
+         sreq[i].cls = req[i].cls;
+      }
+   }
+
+   t_start = now_ns();
+   for (uint i = 0; i < nthr; i++) {
+      if (qdel)
+         pthread_create(&thr[i], NULL, sched_worker, (void *)(uintptr_t)i);
+      else
+         pthread_create(&thr[i], NULL, worker, NULL);
+   }
+   if (qdel) {
+      // Producer: each request enters the queue at its arrival time.
+      for (uint i = 0; i < nreq; i++) {
+         sreq[i].t_in = arrival(i);
+         while (now_ns() < sreq[i].t_in)
+            sched_yield();
+         qdsa_sched_submit(&sched, &sreq[i]);
+      }
+      __atomic_store_n(&sched_done, 1, __ATOMIC_RELEASE);
+   }
+   for (uint i = 0; i < nthr; i++)
+      pthread_join(thr[i], NULL);
+   double secs = (now_ns() - t_start) / 1e9;
+   for (uint i = 0; qdel && i < nreq; i++) {
+      qdel[i] = sreq[i].t_start - sreq[i].t_in;
+      lat[i] = sreq[i].t_done - sreq[i].t_in;
+      if ((sreq[i].res == 0) == req[i].bad) errors++;
+   }
+
+   printf("threads %u, batch %u, rate %.0f/s (0: closed loop), hot %.2f%s, "
+          "invalid %.2f\n",
+      nthr, batch, rate, hot, use_xpk ? " (xpk)" : "", bad);
+   printf("%u requests in %.3fs: %.1f verify/s, %u wrong results\n", nreq,
+      secs, nreq / secs, errors);
+   if (qdel) {
+      static const char *name[CLS_NUM] = { "latency", "bulk" };
+      printf("reserved %u%s\n", reserved, pin ? " (pinned)" : "");
+      for (int c = 0; c < CLS_NUM; c++) {
+         if (!cls_n[c]) continue;
+         printf("%s class, %u requests, us:\n", name[c], cls_n[c]);
+         class_pct("queue delay", qdel, c);
+         class_pct("latency", lat, c);
+      }
+   }
+   if (use_bundle) {
+      if (bundle.fail)
+         printf("bundle rejected at item %u\n", bundle.fail - 1);
+      else
+         printf("bundle passed\n");
+   }
+   // Per-class figures index lat by request; sort only after them.
+   qsort(lat, nreq, sizeof(uint64_t), cmp_u64);
+   printf("latency us: p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+      lat[nreq / 2] / 1e3, lat[(uint64_t)nreq * 99 / 100] / 1e3,
+      lat[(uint64_t)nreq * 999 / 1000] / 1e3, lat[nreq - 1] / 1e3);
+
+   // Log2 histogram: <64us, <128us, ... and a last open bucket.
+   uint hist[16] = { 0 };
+   for (uint i = 0; i < nreq; i++) {
+      uint b = 0;
+      while (b < 15 && lat[i] >= 64000ull << b)
+         b++;
+      hist[b]++;
+   }
+   printf("histogram:\n");
+   for (uint b = 0; b < 16; b++) {
+      if (hist[b])
+         printf("  %s %7lluus %7u\n", b < 15 ? "< " : ">=",
+            (64000ull << (b < 15 ? b : 14)) / 1000, hist[b]);
+   }
+
+   free(ring);
+   free(sreq);
+   free(qdel);
+   free(cls_req[CLS_LAT]);
+   free(cls_req[CLS_BULK]);
+   free(bsig);
+   free(bpk);
+   free(bmsg);
+   free(thr);
+   free(lat);
+   free(req);
+   return errors != 0;
+}
+
+/* vim: set syn=c cin et sw=3 ts=3 tw=80 fo=cjMmnoqr: */
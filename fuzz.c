@@ -0,0 +1,407 @@
+/*
+ * fuzz.c
+ *
+ * Differential harness for the field and hash backends. Each build checks the
+ * backend it was compiled for (C, Thumb-1, Thumb-2, Thumb-2 DSP, AVX-512
+ * K-f[800]; see fuzz.sh) against a reference model: 16-bit digit big integers
+ * reduced to canonical form mod 2^127-1, and a textbook K-f[800]. Field inputs
+ * are any 128-bit values, i.e. also unreduced ones up to 2^128-1.
+ *
+ * Checked: bigint_mul (exact), bigint_red (host, not digested),
+ * fe1271_mulred/sqrred (also with the result aliasing an input),
+ * fe1271_mulconst, fe1271_add/sub/neg, fe1271_hdmrd, fe1271_freeze (result
+ * <= p), kf800_permute (exact, any round count) and bobjr_absorb_copy (copy
+ * and state as with bobjr_absorb_wa). A mismatch prints the operation and
+ * aborts.
+ *
+ * An input is cut into records of REC bytes (the last one padded by
+ * repetition): x[4] (64B), y (16B), a constant (2B), a round count (1B), a
+ * K-f[800] state (100B) and a length byte.
+ *
+ * Built with -DFUZZ_LIBFUZZER it only provides LLVMFuzzerTestOneInput.
+ * Otherwise:
+ *      fuzz -e: run all pairs of edge values
+ *      fuzz [-d] [file...]: run the records of each file, or of stdin (AFL);
+ *         -d prints a digest of all raw outputs per record, so that backends
+ *         can also be compared with each other.
+ */
+
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "qdsv.c"
+
+#include <string.h>
+
+#define REC 184
+
+#ifndef CONF_KF800_FULLR
+#define CONF_KF800_FULLR 0
+#endif
+
+/* -----------------------------------------------------------------------------
+ * Reference model: 16 digits of 16 bits, little-endian.
+ */
+typedef struct {
+   uint32_t d[16];
+} ref;
+
+static void ref_load(ref *r, const uint32_t *w, int nw)
+{
+   memset(r, 0, sizeof(ref));
+   for (int i = 0; i < nw; i++) {
+      r->d[2 * i] = w[i] & 0xffff;
+      r->d[2 * i + 1] = w[i] >> 16;
+   }
+}
+
+/* Canonical residue mod p = 2^127-1. */
+static void ref_modp(ref *r)
+{
+   uint32_t hi[9], c;
+   int more;
+
+   do {
+      more = 0;
+      for (int i = 0; i < 9; i++) {
+         uint32_t a = r->d[7 + i], b = i < 8 ? r->d[8 + i] : 0;
+         hi[i] = ((a >> 15) | (b << 1)) & 0xffff;
+         more |= hi[i];
+      }
+      r->d[7] &= 0x7fff;
+      c = 0;
+      for (int i = 0; i < 16; i++) {
+         c += (i < 8 ? r->d[i] : 0) + (i < 9 ? hi[i] : 0);
+         r->d[i] = c & 0xffff;
+         c >>= 16;
+      }
+   } while (more);
+   // Now < 2^128 with at most bit 127 set again, or exactly p.
+   if ((r->d[7] >> 15) == 0) {
+      int isp = r->d[7] == 0x7fff;
+      for (int i = 0; i < 7; i++)
+         isp &= r->d[i] == 0xffff;
+      if (isp) memset(r->d, 0, 8 * sizeof(uint32_t));
+   }
+   if (r->d[7] >> 15) ref_modp(r);
+}
+
+static void ref_mul(ref *r, const ref *a, const ref *b)
+{
+   uint64_t acc[17] = { 0 };
+
+   for (int i = 0; i < 8; i++)
+      for (int j = 0; j < 8; j++)
+         acc[i + j] += (uint64_t)a->d[i] * b->d[j];
+   for (int i = 0; i < 16; i++) {
+      acc[i + 1] += acc[i] >> 16;
+      r->d[i] = acc[i] & 0xffff;
+   }
+}
+
+/* a + b or a - b, both canonical; result canonical. */
+static void ref_addsub(ref *r, const ref *a, const ref *b, int sub)
+{
+   uint32_t c = 0;
+
+   for (int i = 0; i < 16; i++) {
+      uint32_t bd = b->d[i];
+      if (sub && i < 8) bd = (i == 7 ? 0x7fff : 0xffff) - bd;
+      c += a->d[i] + bd;
+      r->d[i] = c & 0xffff;
+      c >>= 16;
+   }
+   ref_modp(r);
+}
+
+static void fail(const char *op)
+{
+   printf("Mismatch in %s\n", op);
+   fflush(stdout);
+   abort();
+}
+
+/* Backend result (any 128 bits) must be congruent to canonical e. */
+static void expect_fe(const char *op, const fe1271 *x, const ref *e)
+{
+   ref t;
+
+   ref_load(&t, x->v, 4);
+   ref_modp(&t);
+   if (memcmp(t.d, e->d, sizeof(t.d))) fail(op);
+}
+
+static uint32_t ROL(uint32_t x, uint32_t n)
+{
+   return n ? (x << n) | (x >> (32 - n)) : x;
+}
+
+/* Rounds 22-nr..21 of K-f[800], as kf800_permute() does. */
+static void ref_kf800(uint32_t *A, uint nr)
+{
+   static const uint32_t rc[22] = { 0x00000001, 0x00008082, 0x0000808a,
+      0x80008000, 0x0000808b, 0x80000001, 0x80008081, 0x00008009, 0x0000008a,
+      0x00000088, 0x80008009, 0x8000000a, 0x8000808b, 0x0000008b, 0x00008089,
+      0x00008003, 0x00008002, 0x00000080, 0x0000800a, 0x8000000a, 0x80008081,
+      0x00008080 };
+   static const uint8_t rho[25] = { 0, 1, 30, 28, 27, 4, 12, 6, 23, 20, 3, 10,
+      11, 25, 7, 9, 13, 15, 21, 8, 18, 2, 29, 24, 14 };
+   uint32_t B[25], C[5];
+
+   for (uint r = 22 - nr; r < 22; r++) {
+      for (int x = 0; x < 5; x++)
+         C[x] = A[x] ^ A[x + 5] ^ A[x + 10] ^ A[x + 15] ^ A[x + 20];
+      for (int i = 0; i < 25; i++)
+         A[i] ^= C[(i + 4) % 5] ^ ROL(C[(i + 1) % 5], 1);
+      for (int x = 0; x < 5; x++)
+         for (int y = 0; y < 5; y++)
+            B[y + 5 * ((2 * x + 3 * y) % 5)] = ROL(A[x + 5 * y], rho[x + 5 * y]);
+      for (int i = 0; i < 25; i++)
+         A[i] = B[i] ^ (~B[i - i % 5 + (i + 1) % 5] & B[i - i % 5 + (i + 2) % 5]);
+      A[0] ^= rc[r];
+   }
+}
+
+/* -----------------------------------------------------------------------------
+ * One record. Returns an FNV-1a digest of all backend outputs.
+ */
+static uint64_t digest;
+
+static void dg(const void *p, uint len)
+{
+   const uint8_t *b = p;
+   for (uint i = 0; i < len; i++)
+      digest = (digest ^ b[i]) * 0x100000001b3ull;
+}
+
+static uint64_t run(const uint8_t *rec)
+{
+   fe1271 x[4], y, r, r4[4];
+   uint32_t _align4 w[8], A[25], B[25];
+   bobjr_ctx c0, c1;
+   ref rx[4], ry, e, t, a, b, c, d;
+   uint16_t k;
+   uint nr;
+
+   memcpy(x, rec, 64);
+   memcpy(&y, rec + 64, 16);
+   memcpy(&k, rec + 80, 2);
+   nr = rec[82] % (CONF_KF800_FULLR ? 23 : 11);
+   memcpy(A, rec + 83, 100);
+   digest = 0xcbf29ce484222325ull;
+
+   for (int i = 0; i < 4; i++) {
+      ref_load(&rx[i], x[i].v, 4);
+      ref_modp(&rx[i]);
+   }
+   ref_load(&ry, y.v, 4);
+   ref_modp(&ry);
+
+   // bigint_mul: exact product.
+   ref_load(&a, x[0].v, 4);
+   ref_load(&b, y.v, 4);
+   ref_mul(&e, &a, &b);
+   bigint_mul(w, x[0].v, y.v);
+   ref_load(&t, w, 8);
+   if (memcmp(t.d, e.d, sizeof(t.d))) fail("bigint_mul");
+   dg(w, 32);
+#ifndef __thumb__
+   bigint_red(r.v, w);
+   ref_modp(&e);
+   expect_fe("bigint_red", &r, &e);
+#endif
+
+   // Reducing multiply and square, also in place.
+   ref_mul(&e, &rx[0], &ry);
+   ref_modp(&e);
+   fe1271_mulred(&r, &x[0], &y);
+   expect_fe("fe1271_mulred", &r, &e);
+   dg(&r, 16);
+   r = x[0];
+   fe1271_mulred(&r, &r, &y);
+   expect_fe("fe1271_mulred in place", &r, &e);
+   r = y;
+   fe1271_mulred(&r, &x[0], &r);
+   expect_fe("fe1271_mulred in place", &r, &e);
+   ref_mul(&e, &rx[1], &rx[1]);
+   ref_modp(&e);
+   fe1271_sqrred(&r, &x[1]);
+   expect_fe("fe1271_sqrred", &r, &e);
+   dg(&r, 16);
+   r = x[1];
+   fe1271_sqrred(&r, &r);
+   expect_fe("fe1271_sqrred in place", &r, &e);
+
+   // Constant multiply.
+   ref_load(&t, (uint32_t[]) { k }, 1);
+   ref_mul(&e, &rx[2], &t);
+   ref_modp(&e);
+   fe1271_mulconst(&r, &x[2], k);
+   expect_fe("fe1271_mulconst", &r, &e);
+   dg(&r, 16);
+
+   // Add, sub, neg.
+   ref_addsub(&e, &rx[0], &ry, 0);
+   fe1271_add(&r, &x[0], &y);
+   expect_fe("fe1271_add", &r, &e);
+   dg(&r, 16);
+   ref_addsub(&e, &rx[0], &ry, 1);
+   fe1271_sub(&r, &x[0], &y);
+   expect_fe("fe1271_sub", &r, &e);
+   dg(&r, 16);
+   memset(&t, 0, sizeof(t));
+   ref_addsub(&e, &t, &rx[3], 1);
+   r = x[3];
+   fe1271_neg(&r);
+   expect_fe("fe1271_neg", &r, &e);
+   dg(&r, 16);
+
+   // Hadamard: a = x1-x0, b = x2+x3, c = x0+x1, d = x2-x3.
+   ref_addsub(&a, &rx[1], &rx[0], 1);
+   ref_addsub(&b, &rx[2], &rx[3], 0);
+   ref_addsub(&c, &rx[0], &rx[1], 0);
+   ref_addsub(&d, &rx[2], &rx[3], 1);
+   fe1271_hdmrd(r4, x);
+   ref_addsub(&e, &a, &b, 0);
+   expect_fe("fe1271_hdmrd[0]", &r4[0], &e);
+   ref_addsub(&e, &a, &b, 1);
+   expect_fe("fe1271_hdmrd[1]", &r4[1], &e);
+   ref_addsub(&e, &d, &c, 1);
+   expect_fe("fe1271_hdmrd[2]", &r4[2], &e);
+   ref_addsub(&e, &c, &d, 0);
+   expect_fe("fe1271_hdmrd[3]", &r4[3], &e);
+   dg(r4, 64);
+
+   // Freeze: congruent and at most p.
+   r = x[1];
+   fe1271_freeze(&r);
+   expect_fe("fe1271_freeze", &r, &rx[1]);
+   if (r.v[3] >> 31) fail("fe1271_freeze range");
+   dg(&r, 16);
+
+   // K-f[800].
+   memcpy(B, A, 100);
+   kf800_permute(A, nr);
+   ref_kf800(B, nr);
+   if (memcmp(A, B, 100)) fail("kf800_permute");
+   dg(A, 100);
+
+   // Copy and absorb in one pass: 0-25 words, then the whole 100B.
+   uint len = 4 * (rec[183] % 26);
+   memcpy(B, rec + 83, 100);
+   bobjr_init(&c0);
+   bobjr_init(&c1);
+   bobjr_absorb_wa(&c0, (uint8_t *)B, len);
+   bobjr_absorb_wa(&c0, (uint8_t *)B, 100);
+   memset(A, 0, 100);
+   bobjr_absorb_copy(&c1, A, (uint8_t *)B, len);
+   if (memcmp(A, B, len)) fail("bobjr_absorb_copy");
+   bobjr_absorb_copy(&c1, A, (uint8_t *)B, 100);
+   if (memcmp(A, B, 100) || memcmp(&c0, &c1, sizeof(c0)))
+      fail("bobjr_absorb_copy");
+   dg(c1.state, 100);
+   return digest;
+}
+
+static void run_data(const uint8_t *data, size_t len, int print)
+{
+   uint8_t rec[REC];
+
+   for (size_t o = 0; o < len || o == 0; o += REC) {
+      for (uint i = 0; i < REC; i++)
+         rec[i] = len ? data[(o + i < len ? o + i : o + i % (len - o))] : 0;
+      uint64_t h = run(rec);
+      if (print) printf("%016llx\n", (unsigned long long)h);
+   }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t len)
+{
+   run_data(data, len < REC ? len : REC, 0);
+   return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+/* Values around 0, p, 2^127 and 2^128, and a few mixed patterns. */
+static const uint32_t edge[][4] = {
+   { 0, 0, 0, 0 },
+   { 1, 0, 0, 0 },
+   { 2, 0, 0, 0 },
+   { 0xfffffffe, 0xffffffff, 0xffffffff, 0x7fffffff },  // p-1
+   { 0xffffffff, 0xffffffff, 0xffffffff, 0x7fffffff },  // p
+   { 0, 0, 0, 0x80000000 },                             // p+1
+   { 1, 0, 0, 0x80000000 },                             // p+2
+   { 0xfffffffd, 0xffffffff, 0xffffffff, 0xffffffff },  // 2p-1
+   { 0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff },  // 2p
+   { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },  // 2^128-1
+   { 0xffffffff, 0, 0, 0 },
+   { 0, 0xffffffff, 0, 0 },
+   { 0xffffffff, 0xffffffff, 0, 0 },
+   { 0, 0, 0xffffffff, 0xffffffff },
+   { 0x80000000, 0x80000000, 0x80000000, 0x80000000 },
+   { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff },
+   { 0xaaaaaaaa, 0x55555555, 0xaaaaaaaa, 0x55555555 },
+   { 0x0000ffff, 0xffff0000, 0x0000ffff, 0xffff0000 },
+};
+#define NEDGE (sizeof(edge) / sizeof(edge[0]))
+
+static int run_edges(void)
+{
+   static const uint16_t ks[] = { 0, 1, 0xabd7, 0xffff };
+   uint8_t rec[REC];
+
+   for (uint i = 0; i < NEDGE; i++) {
+      for (uint j = 0; j < NEDGE; j++) {
+         memcpy(rec, edge[i], 16);
+         memcpy(rec + 16, edge[j], 16);
+         memcpy(rec + 32, edge[j], 16);
+         memcpy(rec + 48, edge[i], 16);
+         memcpy(rec + 64, edge[j], 16);
+         memcpy(rec + 80, &ks[(i + j) % 4], 2);
+         rec[82] = i + j;
+         for (uint s = 0; s < 100; s++)
+            rec[83 + s] = ((const uint8_t *)edge[(i + s / 16) % NEDGE])[s % 16];
+         rec[183] = 0;
+         run(rec);
+      }
+   }
+   printf("%u edge pairs passed\n", (uint)(NEDGE * NEDGE));
+   return 0;
+}
+
+static int run_file(FILE *f, int print)
+{
+   size_t n = 0, cap = 1 << 16;
+   uint8_t *buf = malloc(cap);
+
+   for (size_t k; (k = fread(buf + n, 1, cap - n, f)) > 0;) {
+      n += k;
+      if (n == cap) buf = realloc(buf, cap *= 2);
+   }
+   run_data(buf, n, print);
+   free(buf);
+   return 0;
+}
+
+int main(int argc, char **argv)
+{
+   int print = 0, nfile = 0;
+
+   for (int i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "-e")) return run_edges();
+      if (!strcmp(argv[i], "-d")) {
+         print = 1;
+         continue;
+      }
+      FILE *f = fopen(argv[i], "rb");
+      if (!f) {
+         printf("Can't open %s\n", argv[i]);
+         return 1;
+      }
+      run_file(f, print);
+      fclose(f);
+      nfile++;
+   }
+   return nfile ? 0 : run_file(stdin, print);
+}
+#endif
+
+/* vim: set syn=c cin et sw=3 ts=3 tw=80 fo=cjMmnoqr: */
@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Differential check of the field and hash backends with fuzz.c.
+#
+# Builds the harness for every backend, runs the edge cases and a random
+# corpus on each (every build checks itself against the reference model of
+# fuzz.c) and compares the per-record output digests of all builds with the
+# same K-f[800] round table.
+#
+# Usage: ./fuzz.sh [records]   (default 2000)
+#
+# Backends: C, C with CONF_QDSA_TINY and the looped K-f[800], AVX-512 K-f[800]
+# (if the CPU has it), and Thumb-1, Thumb-2 and Thumb-2 DSP assembler, also
+# Thumb-1 with the shift-and-add mulconst of CONF_QDSA_SLOWMUL. The Thumb
+# builds need arm-linux-gnueabihf-gcc and qemu-arm and are skipped without
+# them. They are built for ARMv7-A with the feature macros of the smaller cores
+# undefined, which selects the same assembler as for Cortex-M0, M3 and M4; C
+# code is Thumb-2 in all three.
+#
+# Coverage-guided fuzzing of the same harness:
+#   AFL:       afl-clang-fast -o fuzz fuzz.c supp.c; afl-fuzz -i in -o out ./fuzz
+#              (ARM: afl-fuzz -Q on a static ARM build)
+#   libFuzzer: clang -fsanitize=fuzzer -DFUZZ_LIBFUZZER fuzz.c supp.c
+
+SRC=$(cd "$(dirname "$0")" && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+CFLAGS="-Os -Wall"
+ARMCC=${ARMCC:-arm-linux-gnueabihf-gcc}
+QEMU=${QEMU:-qemu-arm}
+NREC=${1:-2000}
+
+head -c $((NREC * 184)) /dev/urandom > "$TMP/corpus"
+
+# name cc flags
+variants()
+{
+   echo "c ${CC:-gcc}"
+   echo "c-tiny ${CC:-gcc} -DCONF_QDSA_TINY -DCONF_KF800_UNROLL=0"
+   grep -qw avx512f /proc/cpuinfo 2> /dev/null && echo "avx512 ${CC:-gcc} -mavx512f"
+   if command -v $ARMCC > /dev/null && command -v $QEMU > /dev/null; then
+      arm="$ARMCC -static -march=armv7-a -mthumb"
+      echo "thumb1 $arm -U__thumb2__ -U__ARM_FEATURE_DSP"
+      echo "thumb1-tiny $arm -U__thumb2__ -U__ARM_FEATURE_DSP -DCONF_QDSA_TINY"
+      echo "thumb1-slowmul $arm -U__thumb2__ -U__ARM_FEATURE_DSP" \
+         "-DCONF_QDSA_SLOWMUL"
+      echo "thumb2 $arm -U__ARM_FEATURE_DSP"
+      echo "thumb2-dsp $arm"
+      echo "thumb2-tiny $arm -DCONF_QDSA_TINY"
+   else
+      echo "thumb: $ARMCC or $QEMU not found, skipped" >&2
+   fi
+}
+
+variants > "$TMP/variants"
+fail=0
+for fullr in 0 1; do
+   ref=
+   while read name cc flags; do
+      exe="$TMP/$name-$fullr"
+      if ! $cc $CFLAGS $flags -DCONF_KF800_FULLR=$fullr -o "$exe" \
+         "$SRC/fuzz.c" "$SRC/supp.c"; then
+         echo "$name FULLR=$fullr: build error"
+         exit 1
+      fi
+      case $name in thumb*) run="$QEMU $exe" ;; *) run=$exe ;; esac
+      if ! $run -e > "$exe.dg" || ! $run -d "$TMP/corpus" >> "$exe.dg"; then
+         echo "$name FULLR=$fullr: $(tail -n 1 "$exe.dg")"
+         exit 1
+      fi
+      if [ -z "$ref" ]; then
+         ref=$exe.dg
+      elif ! cmp -s "$ref" "$exe.dg"; then
+         echo "$name FULLR=$fullr: digests differ from $(basename "${ref%.dg}")"
+         exit 1
+      fi
+      echo "$name FULLR=$fullr: ok"
+   done < "$TMP/variants" || fail=1
+done
+exit $fail
@@ -6,6 +6,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <string.h>
 #include "supp.h"
 #include "qdsv.h"
 
@@ -24,6 +25,8 @@ uint8_t _align4 pk[32];
 uint8_t _align4 sk[64];
 uint8_t _align4 msg[32];
 uint8_t _align4 sig[64];
+uint8_t _align4 xpk[QDSA_XPK_LEN];
+uint8_t _align4 xtab[QDSA_XTAB_LEN];
 
 int devrand;
 
@@ -90,6 +93,342 @@ int test_sign_verify()
    return qdsa_verify(sig, pk, msg);
 }
 
+/* H128 signatures verify only with the H128 verifier. */
+int test_h128()
+{
+   int n = read(devrand, seed, 32);
+   n += read(devrand, msg, 32);
+   qdsa_keypair(pk, sk, seed);
+   qdsa_sign_h128(sig, msg, pk, sk);
+   if (qdsa_verify(sig, pk, msg) == 0) return 1;
+   return qdsa_verify_h128(sig, pk, msg);
+}
+
+/*
+ * Fixed-base table of a fresh key: good signatures pass and altered ones fail.
+ * About half of the random points that decompress are on the twist and have
+ * no table.
+ */
+int test_xtab()
+{
+   int n = read(devrand, seed, 32);
+   n += read(devrand, msg, 32);
+   qdsa_keypair(pk, sk, seed);
+   if (qdsa_pk_expand(xpk, pk) || qdsa_pk_table(xtab, xpk)) return 1;
+   for (int i = 0; i < 8; i++) {
+      qdsa_sign(sig, msg, pk, sk);
+      if (qdsa_verify_xtab(sig, xpk, xtab, msg)) return 1;
+      sig[8 * i] ^= 1 << i;  // R for i < 4, s after
+      if (qdsa_verify_xtab(sig, xpk, xtab, msg) == 0) return 1;
+      msg[i] ^= 0x10;
+   }
+   for (int i = 0; i < 64; i++) {
+      if (read(devrand, pk, 32) != 32) return 1;
+      if (qdsa_pk_expand(xpk, pk) == 0 && qdsa_pk_table(xtab, xpk)) return 0;
+   }
+   return 1;
+}
+
+/* Known answer (TurboSHAKE128 of empty input), then sign-verify a digest. */
+int test_digest()
+{
+   static const uint8_t kat[8] = { 0x1e, 0x41, 0x5f, 0x1c,
+      0x59, 0x83, 0xaf, 0xf2 };
+   static uint8_t img[1000];
+
+   int n = read(devrand, img, sizeof(img));
+   n += read(devrand, seed, 32);
+   if (qdsa_digest(msg, img, 0, QDSA_DIGEST_TS128) || memcmp(msg, kat, 8))
+      return 1;
+   if (qdsa_digest(msg, img + 1, sizeof(img) - 1, 0) == 0) return 1;
+   qdsa_digest(msg, img + 1, sizeof(img) - 1, QDSA_DIGEST_TS128);
+   qdsa_keypair(pk, sk, seed);
+   qdsa_sign(sig, msg, pk, sk);
+   return qdsa_verify(sig, pk, msg);
+}
+
+/*
+ * Streaming verify: blocks across the 68-byte rate boundary give an exact copy
+ * and the plain Bob Jr. hash of the image; a flipped bit fails.
+ */
+int test_stream()
+{
+   static const uint blk[5] = { 4, 64, 68, 200, 664 };
+   static uint8_t _align4 img[1000], dst[1000];
+   qdsa_stream s;
+   bobjr_ctx ctx;
+
+   int n = read(devrand, img, sizeof(img));
+   n += read(devrand, seed, 32);
+   bobjr_init(&ctx);
+   bobjr_absorb_wa(&ctx, img, sizeof(img));
+   bobjr_finish_wa(&ctx);
+   qdsa_keypair(pk, sk, seed);
+   qdsa_sign(sig, ctx.state, pk, sk);
+
+   for (int bad = 0; bad < 2; bad++) {
+      img[999] ^= bad;
+      qdsa_stream_init(&s);
+      for (uint i = 0, off = 0; i < 5; off += blk[i++])
+         qdsa_stream_copy(&s, dst + off, img + off, blk[i]);
+      if (memcmp(dst, img, sizeof(img))
+         || (qdsa_stream_verify(&s, sig, pk) == 0) == bad)
+         return 1;
+   }
+   return 0;
+}
+
+/* A verify charges each of its phases, and nothing else. */
+int test_prof()
+{
+   static const char *name[QDSA_PH_NUM] = { "decompress", "wrap", "scalar",
+      "ladder", "ladder_base", "check", "compress" };
+   uint64_t cyc[QDSA_PH_NUM];
+
+   qdsa_prof_reset();
+   if (qdsa_verify(tv[0].sig, tv[0].pk, tv[0].msg)) return 1;
+   qdsa_prof_get(cyc);
+   for (int i = 0; i < QDSA_PH_NUM; i++)
+      printf("  %-12s %8llu\n", name[i], (unsigned long long)cyc[i]);
+   for (int i = QDSA_PH_DECOMPRESS; i <= QDSA_PH_CHECK; i++)
+      if (cyc[i] == 0) return 1;
+   return cyc[QDSA_PH_COMPRESS] != 0;
+}
+
+#define NB 6
+uint8_t _align4 bseed[NB][32], bpk[NB][32], bsk[NB][64], bmsg[NB][32];
+uint8_t _align4 bsig[NB][64], bss[NB][32], bpk2[NB][32];
+
+/* Batch calls must give the same results as single calls. */
+int test_batch()
+{
+   int n = read(devrand, bseed, sizeof(bseed));
+   n += read(devrand, bmsg, sizeof(bmsg));
+   qdsa_keypair_batch(bpk, bsk, bseed, NB);
+   qdsa_sign_batch(bsig, bmsg, bpk, bsk, NB);
+   for (int i = 0; i < NB; i++) {
+      qdsa_keypair(pk, sk, bseed[i]);
+      qdsa_sign(sig, bmsg[i], pk, sk);
+      if (memcmp(pk, bpk[i], 32) || memcmp(sk, bsk[i], 64)
+         || memcmp(sig, bsig[i], 64) || qdsa_verify(sig, pk, bmsg[i]))
+         return 1;
+   }
+   qdsa_dh_keygen_batch(bpk2, bseed, NB);
+   qdsa_dh_exchange_batch(bss, bpk, bseed, NB);
+   for (int i = 0; i < NB; i++) {
+      qdsa_dh_keygen(pk, bseed[i]);
+      qdsa_dh_exchange(sig, bpk[i], bseed[i]);
+      if (memcmp(pk, bpk2[i], 32) || memcmp(sig, bss[i], 32)) return 1;
+   }
+   return 0;
+}
+
+/*
+ * Bundle: all pass with keys repeated and changing; the lowest bad item is
+ * reported, also for a bad key; a failure of another worker stops the rest.
+ */
+int test_bundle()
+{
+   qdsa_bundle b;
+   int err = 0;
+
+   int n = read(devrand, bseed, sizeof(bseed));
+   n += read(devrand, bmsg, sizeof(bmsg));
+   for (int i = 0; i < NB; i++) {
+      if (i < 2 || i == 4) qdsa_keypair(pk, sk, bseed[i]);
+      wam_copy(bpk[i], pk, 32);
+      qdsa_sign(bsig[i], bmsg[i], bpk[i], sk);
+   }
+   qdsa_bundle_init(&b);
+   err |= qdsa_verify_bundle(&b, bsig, bpk, bmsg, 0, NB) || b.fail;
+
+   bsig[4][40] ^= 1;
+   bsig[5][40] ^= 1;
+   err |= !qdsa_verify_bundle(&b, bsig, bpk, bmsg, 0, NB) || b.fail != 5;
+   err |= !qdsa_verify_bundle(&b, bsig, bpk, bmsg, 0, 2);
+   qdsa_bundle_init(&b);
+   err |= qdsa_verify_bundle(&b, bsig, bpk, bmsg, 0, 4);
+   bpk[2][0] ^= 1;  // fails in decompress or in check
+   err |= !qdsa_verify_bundle(&b, bsig, bpk, bmsg, 0, NB) || b.fail != 3;
+   bpk[2][0] ^= 1;
+   bsig[4][40] ^= 1;
+   bsig[5][40] ^= 1;
+   return err;
+}
+
+/*
+ * Two-class queue: latency requests go first, also on unreserved workers, and
+ * are all that reserved workers take; a bulk batch with two keys still fails a
+ * bad signature and a bad key; a full class refuses more.
+ */
+int test_sched()
+{
+   qdsa_sched s;
+   qdsa_req r[NB + 1], *ring[2 * 8];
+   int err = 0;
+
+   int n = read(devrand, bseed, sizeof(bseed));
+   n += read(devrand, bmsg, sizeof(bmsg));
+   for (int i = 0; i < NB; i++) {
+      if (i < 2 || i == 4) qdsa_keypair(pk, sk, bseed[i]);
+      wam_copy(bpk[i], pk, 32);
+      qdsa_sign(bsig[i], bmsg[i], bpk[i], sk);
+   }
+   wam_copy(bpk2[0], bpk[4], 32);
+   bpk2[0][0] ^= 1;  // fails in decompress or in check
+   bsig[3][40] ^= 1;
+   bsig[5][40] ^= 1;
+   wam_zero(r, sizeof(r));
+   for (int i = 0; i <= NB; i++) {
+      r[i].sig = bsig[i % NB];
+      r[i].pk = i < NB ? bpk[i] : bpk2[0];
+      r[i].msg = bmsg[i % NB];
+      r[i].cls = i % 3 || i == NB ? QDSA_BULK : QDSA_LAT;  // 0, 3 latency
+   }
+
+   qdsa_sched_init(&s, ring, 8, 4, 1);
+   for (int i = 0; i <= NB; i++)
+      err |= qdsa_sched_submit(&s, &r[i]);
+   err |= r[1].res != -1 || !r[1].t_in;
+   err |= qdsa_sched_work(&s, 1) != 1 || r[0].res != 0;
+   err |= qdsa_sched_work(&s, 0) != 1 || r[3].res != 1;
+   err |= qdsa_sched_work(&s, 0) != 0;
+   err |= qdsa_sched_work(&s, 1) != 4;
+   err |= qdsa_sched_work(&s, 1) != 1 || qdsa_sched_work(&s, 1) != 0;
+   err |= r[1].res || r[2].res || r[4].res || r[5].res != 1 || r[NB].res != 1;
+   for (int i = 0; i <= NB; i++)
+      err |= r[i].t_start < r[i].t_in || r[i].t_done < r[i].t_start;
+
+   qdsa_sched_init(&s, ring, 1, 1, 0);
+   err |= qdsa_sched_submit(&s, &r[0]) || !qdsa_sched_submit(&s, &r[3]);
+   bsig[3][40] ^= 1;
+   bsig[5][40] ^= 1;
+   return err;
+}
+
+/*
+ * Autotuner: sane crossover points, the profile survives a save and load, and
+ * batch calls still match single calls with the single and mixed paths forced.
+ */
+int test_tune()
+{
+   qdsa_tune t, u, def;
+   char path[] = "/tmp/qdsaXXXXXX";
+
+   qdsa_tune_get(&def);
+   if (qdsa_tune_run(&t) || t.ns[QDSA_TM_KEYGEN] <= 0
+      || t.ns[QDSA_TM_DH_X] <= 0 || t.lanes_base < 1 || t.lanes_base > 5
+      || t.lanes_dh < 1 || t.lanes_dh > 5)
+      return 1;
+   int fd = mkstemp(path);
+   if (fd < 0) return 1;
+   close(fd);
+   int err = qdsa_tune_save(&t, path) || qdsa_tune_load(&u, path)
+      || u.build != t.build || strcmp(u.cpu, t.cpu)
+      || u.lanes_base != t.lanes_base || u.lanes_dh != t.lanes_dh
+      || u.x2 != t.x2 || u.xpk_min != t.xpk_min;
+   unlink(path);
+   if (err) return 1;
+
+   // 6 calls on 4 lanes: all single, then one chunk on lanes and 2 single.
+   for (uint32_t m = 5; m >= 3; m -= 2) {
+      u.lanes_base = u.lanes_dh = m;
+      u.x2 = m == 3;
+      qdsa_tune_set(&u);
+      err |= test_batch();
+   }
+   qdsa_tune_set(&def);
+   return err;
+}
+
+/*
+ * Cache of 2 entries, 3 peers and 2 local keys: secrets match uncached ones,
+ * repeats hit, the least recently used entry goes, gone entries are zero, and
+ * a pk that does not decompress fails every time and is never stored.
+ */
+int test_dh_cache()
+{
+   static const uint8_t zero[sizeof(qdsa_dh_entry)];
+   qdsa_dh_entry ent[2];
+   qdsa_dh_cache c;
+   uint8_t _align4 ss[32];
+
+   if (read(devrand, bseed, sizeof(bseed)) != sizeof(bseed)) return 1;
+   for (int i = 0; i < 3; i++)
+      qdsa_dh_keygen(bpk[i], bseed[i]);
+   qdsa_dh_cache_init(&c, ent, 2);
+   // (peer, local key): (0,3) (1,3) (0,3) (2,3) (1,3) (0,4)
+   static const int seq[6][2] = { { 0, 3 }, { 1, 3 }, { 0, 3 }, { 2, 3 },
+      { 1, 3 }, { 0, 4 } };
+   for (int i = 0; i < 6; i++) {
+      const uint8_t *p = bpk[seq[i][0]], *s = bseed[seq[i][1]];
+      qdsa_dh_exchange_cached(&c, ss, p, s, seq[i][1]);
+      qdsa_dh_exchange(bss[0], p, s);
+      if (memcmp(ss, bss[0], 32)) return 1;
+   }
+   // Only the 3rd call hits; peer 1 was evicted by peer 2 and came back.
+   if (c.hits != 1 || c.misses != 5) return 1;
+   qdsa_dh_exchange_cached(&c, ss, bpk[1], bseed[3], 3);
+   if (c.hits != 2) return 1;
+   qdsa_dh_cache_drop(&c, NULL, 3);
+   qdsa_dh_exchange_cached(&c, ss, bpk[0], bseed[4], 4);
+   if (c.hits != 3) return 1;
+   int i = 0;
+   do {  // random x-coordinates decompress about half of the time
+      if (read(devrand, bpk[3], 32) != 32 || ++i > 64) return 1;
+   } while (!qdsa_dh_exchange(ss, bpk[3], bseed[4]));
+   for (i = 0; i < 2; i++)
+      if (qdsa_dh_exchange_cached(&c, ss, bpk[3], bseed[4], 4) != 1) return 1;
+   if (c.hits != 3 || c.misses != 7) return 1;
+   qdsa_dh_cache_drop(&c, bpk[0], 4);
+   if (memcmp(&ent[0], zero, sizeof(zero))
+      || memcmp(&ent[1], zero, sizeof(zero)))
+      return 1;
+   return 0;
+}
+
+#define NR 100
+uint8_t _align4 lrec[NR][72];
+
+/*
+ * Log of NR records of 0..71 bytes with a checkpoint after 40 and at the end.
+ * The second half verifies from the state at the first checkpoint; a changed
+ * byte, a dropped record or a wrong start must fail.
+ */
+int test_log()
+{
+   const uint8_t *rec[NR];
+   size_t len[NR];
+   qdsa_log log, mid, start;
+   uint8_t _align4 sig1[64];
+
+   int n = read(devrand, lrec, sizeof(lrec));
+   n += read(devrand, seed, 32);
+   qdsa_keypair(pk, sk, seed);
+   qdsa_log_init(&log, pk);
+   start = log;
+   for (int i = 0; i < NR; i++) {
+      rec[i] = lrec[i];
+      len[i] = (i * 13) % 72;
+      qdsa_log_append(&log, rec[i], len[i]);
+      if (i == 39) {
+         qdsa_log_checkpoint(sig1, &log, pk, sk);
+         mid = log;
+      }
+   }
+   qdsa_log_checkpoint(sig, &log, pk, sk);
+
+   if (qdsa_log_verify(sig1, pk, &start, rec, len, 40)) return 1;
+   if (qdsa_log_verify(sig, pk, &mid, rec + 40, len + 40, NR - 40)) return 1;
+   if (qdsa_log_verify(sig, pk, &start, rec, len, NR)) return 1;
+   if (qdsa_log_verify(sig, pk, &start, rec + 1, len + 1, NR - 1) == 0)
+      return 1;
+   if (qdsa_log_verify(sig, pk, &mid, rec + 40, len + 40, NR - 41) == 0)
+      return 1;
+   lrec[57][len[57] - 1] ^= 1;  // last byte, in the padded tail word
+   return qdsa_log_verify(sig, pk, &mid, rec + 40, len + 40, NR - 40) == 0;
+}
+
 int main(void)
 {
    devrand = open("/dev/random", O_RDONLY);
@@ -107,6 +446,28 @@ int main(void)
       }
    }
 
+   printf("Test vectors for verify with expanded keys:\n");
+   for (int i = 0; i < 3; i++) {
+      if (qdsa_pk_expand(xpk, tv[i].pk) == 0
+         && qdsa_verify_xpk(tv[i].sig, xpk, tv[i].msg) == 0
+         && qdsa_verify_xpk(tv[(i + 1) % 3].sig, xpk, tv[i].msg) != 0) {
+         printf("Pass %d\n", i + 1);
+      } else {
+         printf("Fail! %d\n", i + 1);
+      }
+   }
+
+   printf("Test vectors for verify with fixed-base tables:\n");
+   for (int i = 0; i < 3; i++) {
+      if (qdsa_pk_expand(xpk, tv[i].pk) == 0 && qdsa_pk_table(xtab, xpk) == 0
+         && qdsa_verify_xtab(tv[i].sig, xpk, xtab, tv[i].msg) == 0
+         && qdsa_verify_xtab(tv[(i + 1) % 3].sig, xpk, xtab, tv[i].msg) != 0) {
+         printf("Pass %d\n", i + 1);
+      } else {
+         printf("Fail! %d\n", i + 1);
+      }
+   }
+
    printf("Sign-verify test with random seeds and messages:\n");
 
    for (int i = 0; i < 10; i++) {
@@ -119,6 +480,43 @@ int main(void)
          break;
       }
    }
+
+   printf("Sign-verify test with fixed-base tables:\n");
+   for (int i = 0; i < 3; i++) {
+      printf(test_xtab() == 0 ? "Pass %d\n" : "Fail! %d\n", i + 1);
+   }
+
+   printf("H128 sign-verify test:\n");
+   for (int i = 0; i < 3; i++) {
+      printf(test_h128() == 0 ? "Pass %d\n" : "Fail! %d\n", i + 1);
+   }
+
+   printf("TurboSHAKE128 digest:\n");
+   printf(test_digest() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("Phase cycles of one verify:\n");
+   printf(test_prof() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("Batch calls against single calls:\n");
+   printf(test_batch() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("All-or-nothing bundle verify:\n");
+   printf(test_bundle() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("Two-class verify queue:\n");
+   printf(test_sched() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("Streaming verify of a staged image:\n");
+   printf(test_stream() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("Autotuner profile:\n");
+   printf(test_tune() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("DH shared-secret cache:\n");
+   printf(test_dh_cache() == 0 ? "Pass\n" : "Fail!\n");
+
+   printf("Signed log with checkpoints:\n");
+   printf(test_log() == 0 ? "Pass\n" : "Fail!\n");
    close(devrand);
    return 0;
 }
@@ -0,0 +1,100 @@
+/*
+ * qconst.h
+ *
+ * Generated by qgen.cpp; do not edit.
+ */
+
+static const uint8_t mu_1 = 0x0b;
+static const uint8_t mu_2 = 0x16;
+static const uint8_t mu_3 = 0x13;
+static const uint8_t mu_4 = 0x03;
+static const uint16_t muhat[4] = { 0x0021, 0x000b, 0x0011, 0x0031 };
+static const uint16_t e_cons[4] = { 0x72, 0x39, 0x42, 0x1a2 };
+static const uint16_t ehat[4] = { 0x341, 0x9c3, 0x651, 0x231 };
+
+/* Wrapped base point. */
+static const kpoint bpw = {
+   .Y = { .v = { 0x4e931a48, 0xaeb351a6, 0x2049c2e7, 0x1be0c3dc } },
+   .Z = { .v = { 0xe07e36df, 0x64659818, 0x8eaba630, 0x23b416cd } },
+   .T = { .v = { 0x7215441e, 0xc7ae3d05, 0x4447a24d, 0x5db35c38 } }
+};
+
+/* B_{ij} constants, see bijconst. */
+static const bijconst bijc[6] = {
+   // B12
+   { { .v = { 0x10dc4f11, 0x84b582ff, 0xbaa619af, 0x08fd6e72 } }, 0x341, 0x4ac },
+   // B13
+   { { .v = { 0x2625f118, 0xae147ae1, 0x147ae147, 0x7ae147ae } }, 0x21b, 0x44c },
+   // B14
+   { { .v = { 0x73e56485, 0xd44aed44, 0x4aed44ae, 0x6d44aed4 } }, 0x0bb, 0x70c },
+   // B23
+   { { .v = { 0xb5a50945, 0xd44aed44, 0x4aed44ae, 0x6d44aed4 } }, 0x651, 0x70c },
+   // B24
+   { { .v = { 0x67e595d8, 0xae147ae1, 0x147ae147, 0x7ae147ae } }, 0x231, 0x44c },
+   // B34
+   { { .v = { 0x529bf3d1, 0x84b582ff, 0xbaa619af, 0x08fd6e72 } }, 0x16b, 0x4ac },
+};
+
+#if CONF_QDSA_XTAB
+/* f1..f4 of the curve, see jpoint. */
+static const fe1271 jf[4] = {
+   { .v = { 0x1e4a8d6e, 0xf537cd79, 0x8e0c2f16, 0x1edd6ee4 } },
+   { .v = { 0x64c39a35, 0x0c9cd1b1, 0x6d9fcc21, 0x73e799e3 } },
+   { .v = { 0x188df6e8, 0xc47dc236, 0x48b6069c, 0x4b9e333f } },
+   { .v = { 0x6463e172, 0x39ad9e9f, 0xbb9dfe2b, 0x219cc3f8 } },
+};
+
+/* Cassels-Flynn coordinates to the Kummer, and back. */
+static const fe1271 jM[4][4] = {
+   {
+      { .v = { 0x58946303, 0xca9d03e8, 0x233eebb7, 0x213aa0d5 } },
+      { .v = { 0x450dfb19, 0x6ccae9b4, 0xf6bd5247, 0x0fd8dfac } },
+      { .v = { 0x17b4dfdd, 0x6b0582c0, 0x2083354b, 0x773296c4 } },
+      { .v = { 0xa33d2508, 0x282f938b, 0xe8bf786d, 0x78f4898e } },
+   },
+   {
+      { .v = { 0xce289a0c, 0x41f093dd, 0x94511a17, 0x71e239d6 } },
+      { .v = { 0xdd790273, 0x499a8b25, 0x84a156dc, 0x38139029 } },
+      { .v = { 0x6901479f, 0x06c49bf1, 0x4cdd99fe, 0x39d582f4 } },
+      { .v = { 0xb985b5ee, 0xafa0d8e8, 0x2e810f25, 0x0e16ece2 } },
+   },
+   {
+      { .v = { 0xef02b04a, 0xe031ade9, 0xef61162d, 0x6137b521 } },
+      { .v = { 0x20b073b1, 0x1a78c2c7, 0x0a5fa27e, 0x7c57c169 } },
+      { .v = { 0x9c2d8674, 0x597c5358, 0x5919a1e1, 0x60375abc } },
+      { .v = { 0x432205d9, 0x8c0ae9e0, 0x9c86bba0, 0x2370e3da } },
+   },
+   {
+      { .v = { 0x2d38824d, 0x12298bd9, 0x17093112, 0x20c34ebc } },
+      { .v = { 0x245d8767, 0x525226ed, 0xec5dafc9, 0x13811e43 } },
+      { .v = { 0x62f1ea50, 0x7af6fa7e, 0x6302a2cc, 0x4a67f4bf } },
+      { .v = { 0x7663b014, 0x2395ef08, 0x91fa5385, 0x6aa60907 } },
+   },
+};
+static const fe1271 jMi[4][4] = {
+   {
+      { .v = { 0x0b652469, 0x4d78eacf, 0xdb735909, 0x6187b83a } },
+      { .v = { 0xb9ca522e, 0xf50dfd08, 0x26ab964c, 0x650a9a7f } },
+      { .v = { 0x92dbcb26, 0xaa8c8b3e, 0x11e644fc, 0x56bc71fb } },
+      { .v = { 0x8a8c798d, 0x343000d5, 0xed0a4358, 0x05fa64a7 } },
+   },
+   {
+      { .v = { 0x757a73fd, 0x4282f21c, 0xa0310582, 0x03cddd98 } },
+      { .v = { 0xc542c601, 0xdebe86f1, 0xafe77d3e, 0x3e191133 } },
+      { .v = { 0x0e1e790b, 0x9fc512e8, 0xad95a4df, 0x6084a8b6 } },
+      { .v = { 0x041653f5, 0x9e8acd13, 0xa0b3bedd, 0x0df2d72f } },
+   },
+   {
+      { .v = { 0x3011d958, 0xf80ae8e0, 0x66520880, 0x28cc89ac } },
+      { .v = { 0x1198ca40, 0xe6c02838, 0xaa5c2e87, 0x28baa51b } },
+      { .v = { 0x4f022eaa, 0xa2225267, 0x3da9fb06, 0x4bb0a803 } },
+      { .v = { 0x90287f89, 0xee78250c, 0xb9fee974, 0x0b8bc098 } },
+   },
+   {
+      { .v = { 0x3a6615f9, 0xcdd79f02, 0x4140ca3a, 0x69074c1c } },
+      { .v = { 0x8b33d40c, 0x6450c1fb, 0x7d7e6b8a, 0x2df167c7 } },
+      { .v = { 0x53be0982, 0xc5281c9a, 0x76cf8a50, 0x531fd1db } },
+      { .v = { 0x0d38f407, 0x627f98ba, 0x054930c9, 0x13dc9a66 } },
+   },
+};
+#endif
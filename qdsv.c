@@ -12,6 +12,12 @@
  *  - use WAM for fast copy/zeroize/swap on small aligned memory blocks.
  *  - use variable-time Ladder swap in verifier-only compile (saves ~140Kc).
  *  - interfaces are changed for convenience.
+ *  - optional expanded public keys to skip decompress/xWRAP on known keys.
+ *  - optional per-key fixed-base tables for [h]Q, on the Jacobian.
+ *  - optional multi-lane batch engine for signing, keygen and DH on hosts.
+ *  - optional lane-parallel evaluation of the verifier check().
+ *  - optional TurboSHAKE128 image digest for hosts.
+ *  - optional per-phase cycle counters.
  *
  * Limitations:
  *  - message size is fixed to 32 bytes.
@@ -42,6 +48,159 @@
 #define CONF_QDSA_FULL 0
 #endif
 
+/*
+ * Smallest verifier for ROM bootloaders, at a known cycle cost: Thumb-1 SQR
+ * goes through MUL (+930Kc), K-f[800] is the looped C version also on Thumb-2,
+ * T_inv and B_ii loop over index patterns, and K_2..K_4 are merged and share
+ * l1*l2. `make sweep` reports the Flash of each core with and without it.
+ */
+#ifndef CONF_QDSA_TINY
+#define CONF_QDSA_TINY 0
+#endif
+
+/*
+ * Cortex-M0/M0+ built with the small iterative multiplier (32c MULS): Mulconst
+ * shifts and adds instead of 8 MULS, 114-240c instead of 315c for the Ladder
+ * constants, ~-710Kc per verify. Thumb-1 only; slower with the single-cycle
+ * multiplier (67c per call).
+ */
+#ifndef CONF_QDSA_SLOWMUL
+#define CONF_QDSA_SLOWMUL 0
+#endif
+
+/*
+ * Lanes of the batch engine for signing, keygen and DH, and optionally
+ * check(); 0 to disable. Host only; use 4 for SSE2/NEON, 8 for AVX2, 16 for
+ * AVX-512 and build with -O3 and a matching -march.
+ */
+#ifndef CONF_QDSA_LANES
+#define CONF_QDSA_LANES 0
+#endif
+
+/*
+ * Signature variant H128 (v1): the challenge h is the first 128 bits of a
+ * tagged hash instead of the full hash mod N, so the [h]Q Ladder runs 128
+ * steps instead of 251. Not compatible with plain qDSA signatures; only for
+ * closed systems that control both ends. 128-bit challenges keep the usual
+ * 128-bit security level of Schnorr-type signatures.
+ */
+#ifndef CONF_QDSA_H128
+#define CONF_QDSA_H128 0
+#endif
+
+/*
+ * Share one ehat scaling between the two products in xDBLADD: 8 instead of 12
+ * constant multiplications per step, but 4 SQR become MUL. Pays off when SQR
+ * costs the same as MUL, i.e. Thumb-2 and the C version; Thumb-1 has a faster
+ * dedicated squarer.
+ */
+#ifndef CONF_XDBLADD_SHAREC
+#ifdef __thumb__
+#ifdef __thumb2__
+#define CONF_XDBLADD_SHAREC 1
+#else
+#define CONF_XDBLADD_SHAREC 0
+#endif
+#else
+#define CONF_XDBLADD_SHAREC 1
+#endif
+#endif
+
+/* Run check() of the verifier on the lane engine; needs CONF_QDSA_LANES. */
+#ifndef CONF_QDSA_CHECKX
+#define CONF_QDSA_CHECKX 0
+#endif
+
+#if CONF_QDSA_CHECKX && CONF_QDSA_LANES < 4
+#error "CONF_QDSA_CHECKX needs CONF_QDSA_LANES of 4 or more."
+#endif
+
+/* Expanded public key support for verifiers with a known or hot key. */
+#ifndef CONF_QDSA_XPK
+#define CONF_QDSA_XPK 0
+#endif
+
+/*
+ * Per-key fixed-base tables for [h]Q on top of the expanded keys: a signed
+ * 4-bit comb in the Jacobian behind the Kummer; see qdsa_pk_table.
+ */
+#ifndef CONF_QDSA_XTAB
+#define CONF_QDSA_XTAB 0
+#endif
+
+#if CONF_QDSA_XTAB && !CONF_QDSA_XPK
+#error "CONF_QDSA_XTAB needs CONF_QDSA_XPK."
+#endif
+
+/*
+ * Versioned image digest for producing the 32-byte message. Made for hosts
+ * (K-f[1600] is slow on 32-bit cores); devices hash with Bob Jr. as before.
+ */
+#ifndef CONF_QDSA_DIGEST
+#define CONF_QDSA_DIGEST 0
+#endif
+
+/*
+ * All-or-nothing verify of a bundle of signatures, split over any number of
+ * workers that share a qdsa_bundle; the first failure stops them all.
+ */
+#ifndef CONF_QDSA_BUNDLE
+#define CONF_QDSA_BUNDLE 0
+#endif
+
+/*
+ * Two-class verify queue for servers: latency requests one at a time ahead of
+ * bulk batches grouped by key, with workers reserved for the former; see
+ * qdsa_sched_*. Needs a POSIX host with atomics.
+ */
+#ifndef CONF_QDSA_SCHED
+#define CONF_QDSA_SCHED 0
+#endif
+
+/*
+ * Verify an image while staging it from external flash: qdsa_stream_* copy
+ * and hash each block in one pass. The message is the Bob Jr. hash of the
+ * image.
+ */
+#ifndef CONF_QDSA_STREAM
+#define CONF_QDSA_STREAM 0
+#endif
+
+/*
+ * Cache of DH shared secrets for peers that come back; see qdsa_dh_cache_*.
+ * Needs CONF_QDSA_FULL.
+ */
+#ifndef CONF_QDSA_DHC
+#define CONF_QDSA_DHC 0
+#endif
+
+/*
+ * Signed log: records hash-chained with Bob Jr, with a signature on the chain
+ * head now and then; see qdsa_log_*. Checkpoints also need CONF_QDSA_FULL.
+ */
+#ifndef CONF_QDSA_LOG
+#define CONF_QDSA_LOG 0
+#endif
+
+/*
+ * Host autotuner: times the single and lane paths, both Bob Jr. engines and
+ * the expanded-key verify, and sets the crossover points of the batch calls
+ * from them; see qdsa_tune_*. Needs CONF_QDSA_FULL and a POSIX host.
+ */
+#ifndef CONF_QDSA_TUNE
+#define CONF_QDSA_TUNE 0
+#endif
+
+#if CONF_QDSA_TUNE && !CONF_QDSA_FULL
+#error "CONF_QDSA_TUNE needs CONF_QDSA_FULL."
+#endif
+
+/*
+ * Per-phase cycle counts of verify, sign and DH for tuning; CONF_QDSA_PROF is
+ * defaulted in supp.h next to the clock. The counters are global, so keep
+ * concurrent calls apart. Disabled, the hooks compile to nothing.
+ */
+
 /* Field element, 16B/4W. */
 typedef union {
    uint8_t b[16];
@@ -49,20 +208,33 @@ typedef union {
 } _align4 fe1271;
 
 /* Assembly routines for Cortex-M series. */
-static void bigint_sqr(uint32_t *r, const uint32_t *x);
+static void _ramfn(MUL) fe1271_sqrred(fe1271 *r, const fe1271 *x);
 #ifdef __thumb2__
-// Thumb-2 MUL is a label inside SQR assembler.
-void bigint_mul(uint32_t *r, const uint32_t *x, const uint32_t *y);
+// Thumb-2 MULRED and MUL are labels inside SQRRED assembler.
+void _ramfn(MUL) fe1271_mulred(
+   fe1271 *r, const fe1271 *x, const fe1271 *y);
+void _ramfn(MUL) bigint_mul(
+   uint32_t *r, const uint32_t *x, const uint32_t *y);
+#elif defined(__thumb__)
+// Thumb-1 MUL is a label inside MULRED assembler.
+static void _ramfn(MUL) fe1271_mulred(
+   fe1271 *r, const fe1271 *x, const fe1271 *y);
+void _ramfn(MUL) bigint_mul(
+   uint32_t *r, const uint32_t *x, const uint32_t *y);
 #else
-static void bigint_mul(uint32_t *r, const uint32_t *x, const uint32_t *y);
+static void _ramfn(MUL) fe1271_mulred(
+   fe1271 *r, const fe1271 *x, const fe1271 *y);
+static void _ramfn(MUL) bigint_mul(
+   uint32_t *r, const uint32_t *x, const uint32_t *y);
+static void _ramfn(MUL) bigint_red(uint32_t *r, const uint32_t *a);
 #endif
-static void bigint_red(uint32_t *r, const uint32_t *a);
-static void fe1271_mulconst(fe1271 *r, const fe1271 *x, uint16_t y);
-static void fe1271_add(fe1271 *r, const fe1271 *x, const fe1271 *y);
-static void fe1271_sub(fe1271 *r, const fe1271 *x, const fe1271 *y);
+static void _ramfn(MULC) fe1271_mulconst(
+   fe1271 *r, const fe1271 *x, uint16_t y);
+static void _ramfn(ADD) fe1271_add(fe1271 *r, const fe1271 *x, const fe1271 *y);
+static void _ramfn(ADD) fe1271_sub(fe1271 *r, const fe1271 *x, const fe1271 *y);
 // Hdmrd can be made unary as well but it may not be beneficial.
-static void fe1271_hdmrd(fe1271 *r, const fe1271 *x);
-static void fe1271_neg(fe1271 *x);
+static void _ramfn(ADD) fe1271_hdmrd(fe1271 *r, const fe1271 *x);
+static void _ramfn(ADD) fe1271_neg(fe1271 *x);
 static void fe1271_freeze(fe1271 *x);
 
 #include "fe1271.inc"
@@ -93,6 +265,38 @@ typedef union {
    };
 } _align4 ckpoint;
 
+/*
+ * Reduced divisor on the curve C behind the Kummer (see qgen.cpp) in Mumford
+ * form u = x^2 + u1 x + u0, v = v1 x + v0, 64B/16W. Only for CONF_QDSA_XTAB.
+ */
+typedef struct {
+   fe1271 u1;
+   fe1271 u0;
+   fe1271 v1;
+   fe1271 v0;
+} _align4 jpoint;
+
+/*
+ * Constants of B_{ij}, folded for a permutation (c1,c2,c3,c4) of muhat:
+ *      c34   = c3*c4
+ *      c1234 = c1*c2 + c3*c4
+ *      K     = ±2C * c1*c2 * (c2*c4 + c1*c3) * (c2*c3 + c1*c4) mod p
+ * K also carries the factor 2C of quad() and is negated for B23, B24 and B34.
+ * C = 0x40f50eefa320a2dd46f7e3d8cddda843.
+ */
+typedef struct {
+   fe1271 K;
+   uint16_t c34;
+   uint16_t c1234;
+} bijconst;
+
+/*
+ * Kummer constants, base point and B_{ij} constants, and the curve and maps of
+ * CONF_QDSA_XTAB; generated by qgen.cpp from mu, muhat, C and the base point
+ * (make consts).
+ */
+#include "qconst.h"
+
 static void fe1271_setzero(fe1271 *r)
 {
    wam_zero(r, sizeof(fe1271));
@@ -117,71 +321,55 @@ static int fe1271_zeroness(fe1271 *r)
    return !(t == 0);
 }
 
-static void fe1271_mul(fe1271 *r, const fe1271 *x, const fe1271 *y)
-{
-   uint32_t t[8];
-
-   bigint_mul(t, x->v, y->v);
-   bigint_red(r->v, t);
-}
-
-static void fe1271_square(fe1271 *r, const fe1271 *x)
-{
-   uint32_t t[8];
-
-   bigint_sqr(t, x->v);
-   bigint_red(r->v, t);
-}
-
 static void fe1271_powminhalf(fe1271 *r, const fe1271 *x)
 {
    int i;
    fe1271 x2, x3, x6;
 
    // Total: 11 MUL, 125 SQR.
-   fe1271_square(&x2, x);      // 2
-   fe1271_mul(&x3, &x2, x);    // 3
-   fe1271_square(&x6, &x3);    // 6
-   fe1271_square(&x6, &x6);    // 12
-   fe1271_mul(&x3, &x6, &x3);  // 2^4-1
-   fe1271_square(&x6, &x3);    // 30
-   fe1271_mul(&x6, &x6, x);    // 2^5-1
-   fe1271_square(r, &x6);      // 2^6-2
+   fe1271_sqrred(&x2, x);         // 2
+   fe1271_mulred(&x3, &x2, x);    // 3
+   fe1271_sqrred(&x6, &x3);       // 6
+   fe1271_sqrred(&x6, &x6);       // 12
+   fe1271_mulred(&x3, &x6, &x3);  // 2^4-1
+   fe1271_sqrred(&x6, &x3);       // 30
+   fe1271_mulred(&x6, &x6, x);    // 2^5-1
+   fe1271_sqrred(r, &x6);         // 2^6-2
    for (i = 0; i < 4; i++)
-      fe1271_square(r, r);   // 2^10-2^5
-   fe1271_mul(&x6, r, &x6);  // 2^10-1
-   fe1271_square(r, &x6);    // 2^11-2
+      fe1271_sqrred(r, r);      // 2^10-2^5
+   fe1271_mulred(&x6, r, &x6);  // 2^10-1
+   fe1271_sqrred(r, &x6);       // 2^11-2
    for (i = 0; i < 9; i++)
-      fe1271_square(r, r);   // 2^20-2^10
-   fe1271_mul(&x6, r, &x6);  // 2^20-1
-   fe1271_square(r, &x6);    // 2^21-2
+      fe1271_sqrred(r, r);      // 2^20-2^10
+   fe1271_mulred(&x6, r, &x6);  // 2^20-1
+   fe1271_sqrred(r, &x6);       // 2^21-2
    for (i = 0; i < 19; i++)
-      fe1271_square(r, r);   // 2^40-2^20
-   fe1271_mul(&x6, r, &x6);  // 2^40-1
-   fe1271_square(r, &x6);    // 2^41-2
+      fe1271_sqrred(r, r);      // 2^40-2^20
+   fe1271_mulred(&x6, r, &x6);  // 2^40-1
+   fe1271_sqrred(r, &x6);       // 2^41-2
    for (i = 0; i < 39; i++)
-      fe1271_square(r, r);  // 2^80-2^40
-   fe1271_mul(r, r, &x6);   // 2^80-1
+      fe1271_sqrred(r, r);    // 2^80-2^40
+   fe1271_mulred(r, r, &x6);  // 2^80-1
    for (i = 0; i < 40; i++)
-      fe1271_square(r, r);  // 2^120-2^40
-   fe1271_mul(r, r, &x6);   // 2^120-1
+      fe1271_sqrred(r, r);    // 2^120-2^40
+   fe1271_mulred(r, r, &x6);  // 2^120-1
    for (i = 0; i < 4; i++)
-      fe1271_square(r, r);   // 2^124-2^4
-   fe1271_mul(r, r, &x3);    // 2^124-1
-   fe1271_square(r, r);      // 2^125-2
-   fe1271_mul(&x6, r, &x2);  // 2^125
-   fe1271_square(&x6, &x6);  // 2^126
-   fe1271_mul(r, r, &x6);
+      fe1271_sqrred(r, r);      // 2^124-2^4
+   fe1271_mulred(r, r, &x3);    // 2^124-1
+   fe1271_sqrred(r, r);         // 2^125-2
+   fe1271_mulred(&x6, r, &x2);  // 2^125
+   fe1271_sqrred(&x6, &x6);     // 2^126
+   fe1271_mulred(r, r, &x6);
 }
 
 static void fe1271_invert(fe1271 *r, const fe1271 *x)
 {
    fe1271 t;
 
-   fe1271_square(r, x);
+   fe1271_sqrred(r, x);
    fe1271_powminhalf(r, r);
-   fe1271_mul(&t, r, x);
-   fe1271_mul(r, r, &t);
+   fe1271_mulred(&t, r, x);
+   fe1271_mulred(r, r, &t);
 }
 
 static void set_const(fe1271 *r, uint16_t c)
@@ -190,16 +378,6 @@ static void set_const(fe1271 *r, uint16_t c)
    r->v[0] = c;
 }
 
-static void fe1271_sum(
-   fe1271 *r, fe1271 *t, uint16_t c1, uint16_t c2, uint16_t c3, uint16_t c4)
-{
-   set_const(t, c1);
-   fe1271_mulconst(t, t, c2);
-   set_const(r, c3);
-   fe1271_mulconst(r, r, c4);
-   fe1271_add(r, r, t);
-}
-
 /*
  * Return the square-root of delta, with sign of sigma, if it exists.
  *
@@ -214,8 +392,8 @@ static int fe1271_has_sqrt(
    fe1271 *R, fe1271 *t, const fe1271 *delta, uint8_t sigma)
 {
    fe1271_powminhalf(R, delta);
-   fe1271_mul(R, R, delta);
-   fe1271_square(t, R);
+   fe1271_mulred(R, R, delta);
+   fe1271_sqrred(t, R);
    fe1271_sub(t, t, delta);
    if (fe1271_zeroness(t) != 0) {
       return 1;
@@ -227,6 +405,141 @@ static int fe1271_has_sqrt(
    return 0;
 }
 
+/* -----------------------------------------------------------------------------
+ * Scalars mod N = 2^250 - L: scalar_red (512 -> 250 bits), scalar_mul
+ * (256x256, reduced) and scalar_sub. Results are canonical, i.e. < N.
+ */
+#if defined(__SIZEOF_INT128__) && !defined(__thumb__)
+/*
+ * Hosts: 64-bit limbs and Barrett reduction (HAC 14.42, b = 2^64, k = 4).
+ */
+typedef unsigned __int128 uint128_t;
+
+static const uint64_t scalar_N[4] = { 0xb88cf4b47bf3fa43, 0x2d3d8036065eab00,
+   0xfccb2967df38ad6b, 0x03ffffffffffffff };
+// floor(2^512 / N)
+static const uint64_t scalar_mu[5] = { 0x238125f1b11df0bf, 0x47ba696ccdc4d606,
+   0x4d69820c75294d55, 0x33, 0x40 };
+
+/* r = x - N if that does not borrow, else x; x < 2^256. Constant time. */
+static void scalar_csub(uint64_t *x)
+{
+   uint64_t t[4], m, b = 0;
+
+   for (int i = 0; i < 4; i++) {
+      uint128_t d = (uint128_t)x[i] - scalar_N[i] - b;
+      t[i] = (uint64_t)d;
+      b = (uint64_t)(d >> 64) & 1;
+   }
+   m = b - 1;  // all ones if no borrow
+   for (int i = 0; i < 4; i++)
+      x[i] ^= (x[i] ^ t[i]) & m;
+}
+
+/* x is 8 limbs, result 4 limbs < N. */
+static void scalar_barrett(uint64_t *r, const uint64_t *x)
+{
+   uint64_t q[10] = { 0 }, t[5] = { 0 }, b = 0;
+   uint128_t acc;
+
+   // q3 = floor(floor(x / b^3) * mu / b^5)
+   for (int i = 0; i < 5; i++) {
+      uint64_t c = 0;
+      for (int j = 0; j < 5; j++) {
+         acc = (uint128_t)x[3 + i] * scalar_mu[j] + q[i + j] + c;
+         q[i + j] = (uint64_t)acc;
+         c = (uint64_t)(acc >> 64);
+      }
+      q[i + 5] = c;
+   }
+   // t = q3 * N mod b^5
+   for (int i = 0; i < 5; i++) {
+      uint64_t c = 0;
+      for (int j = 0; j < 4 && i + j < 5; j++) {
+         acc = (uint128_t)q[5 + i] * scalar_N[j] + t[i + j] + c;
+         t[i + j] = (uint64_t)acc;
+         c = (uint64_t)(acc >> 64);
+      }
+      if (i == 0) t[4] += c;
+   }
+   // r = x mod b^5 - t, which is < 3N < b^4.
+   for (int i = 0; i < 4; i++) {
+      acc = (uint128_t)x[i] - t[i] - b;
+      r[i] = (uint64_t)acc;
+      b = (uint64_t)(acc >> 64) & 1;
+   }
+   scalar_csub(r);
+   scalar_csub(r);
+}
+
+static void scalar_load(uint64_t *r, const uint32_t *x, uint n)
+{
+   for (uint i = 0; i < n; i++)
+      r[i] = x[2 * i] | (uint64_t)x[2 * i + 1] << 32;
+}
+
+static void scalar_store(uint32_t *r, const uint64_t *x)
+{
+   for (int i = 0; i < 4; i++) {
+      r[2 * i] = (uint32_t)x[i];
+      r[2 * i + 1] = (uint32_t)(x[i] >> 32);
+   }
+}
+
+static void scalar_red(uint32_t *res, const uint32_t *x)
+{
+   uint64_t t[8], r[4];
+
+   scalar_load(t, x, 8);
+   scalar_barrett(r, t);
+   scalar_store(res, r);
+}
+
+#if CONF_QDSA_FULL
+static void scalar_mul(uint32_t *res, const uint32_t *x, const uint32_t *y)
+{
+   uint64_t a[4], b[4], t[8] = { 0 }, r[4];
+   uint128_t acc;
+
+   scalar_load(a, x, 4);
+   scalar_load(b, y, 4);
+   for (int i = 0; i < 4; i++) {
+      uint64_t c = 0;
+      for (int j = 0; j < 4; j++) {
+         acc = (uint128_t)a[i] * b[j] + t[i + j] + c;
+         t[i + j] = (uint64_t)acc;
+         c = (uint64_t)(acc >> 64);
+      }
+      t[i + 4] = c;
+   }
+   scalar_barrett(r, t);
+   scalar_store(res, r);
+}
+
+/* x, y < N */
+static void scalar_sub(uint32_t *res, const uint32_t *x, const uint32_t *y)
+{
+   uint64_t a[4], b[4], c = 0;
+   uint128_t acc;
+
+   scalar_load(a, x, 4);
+   scalar_load(b, y, 4);
+   for (int i = 0; i < 4; i++) {  // N - y
+      acc = (uint128_t)scalar_N[i] - b[i] - c;
+      b[i] = (uint64_t)acc;
+      c = (uint64_t)(acc >> 64) & 1;
+   }
+   for (int i = 0; i < 4; i++) {  // x + N - y < 2N
+      acc = (uint128_t)a[i] + b[i] + c;
+      a[i] = (uint64_t)acc;
+      c = (uint64_t)(acc >> 64);
+   }
+   scalar_csub(a);
+   scalar_store(res, a);
+}
+#endif
+
+#else
 /*
  * 512+=256 large integer addition, possibly starting at an offset in x.
  * Changed from r=x+y to in-place addition x+=y. 48 invocations.
@@ -268,8 +581,42 @@ static void large_mul(uint32_t *r, const uint32_t *x, const uint32_t *y)
    large_add(r, temp, 8);
 }
 
+static const uint32_t large_N[8] = { 0x7BF3FA43, 0xB88CF4B4, 0x65EAB00,
+   0x2D3D8036, 0xDF38AD6B, 0xFCCB2967, 0xFFFFFFFF, 0x3FFFFFF };
+
+#if CONF_QDSA_FULL
+static void large_neg(uint32_t *r, const uint32_t *x)
+{
+   uint64_t t0, t1;
+   uint32_t carry = 0;
+   for (int i = 0; i < 8; i++) {
+      t0 = (uint64_t)large_N[i];
+      t1 = (uint64_t)x[i];
+      t1 += carry;
+      t0 -= t1;
+      carry = (t0 >> 32) & 1;
+      r[i] = (uint32_t)t0;
+   }
+}
+#endif
+
+/* r = x mod N for x < 2N, constant time. */
+static void large_freeze(uint32_t *r, const uint32_t *x)
+{
+   uint64_t t0;
+   uint32_t t[8], mask, carry = 0;
+   for (int i = 0; i < 8; i++) {
+      t0 = (uint64_t)x[i] - large_N[i] - carry;
+      carry = (t0 >> 32) & 1;
+      t[i] = (uint32_t)t0;
+   }
+   mask = carry - 1;  // all ones if x >= N
+   for (int i = 0; i < 8; i++)
+      r[i] = x[i] ^ ((x[i] ^ t[i]) & mask);
+}
+
 /* 512 -> 250-bit reduction modulo N. 2 invocations. */
-static void large_red(uint32_t *res, const uint32_t *x)
+static void scalar_red(uint32_t *res, const uint32_t *x)
 {
    static const uint32_t L[8] = { 0x840C05BD, 0x47730B4B, 0xF9A154FF,
       0xD2C27FC9, 0x20C75294, 0x334D698, 0x0, 0x0 };
@@ -295,8 +642,30 @@ static void large_red(uint32_t *res, const uint32_t *x)
    large_mul(temp, r + 8, L);
    r[8] = 0;
    large_add(r, temp, 0);
-   wam_copy(res, r, 8 * 4);
+   large_freeze(res, r);
+}
+
+#if CONF_QDSA_FULL
+static void scalar_mul(uint32_t *r, const uint32_t *x, const uint32_t *y)
+{
+   uint32_t t[16];
+
+   large_mul(t, x, y);
+   scalar_red(r, t);
+}
+
+/* x, y < N */
+static void scalar_sub(uint32_t *r, const uint32_t *x, const uint32_t *y)
+{
+   uint32_t t[16];
+
+   wam_zero(&t[8], 8 * 4);
+   large_neg(t, y);
+   large_add(t, x, 0);
+   scalar_red(r, t);
 }
+#endif
+#endif
 
 /*
  * Pairwise multiply two tuples, where the second tuple has small values.
@@ -307,7 +676,7 @@ static void large_red(uint32_t *res, const uint32_t *x)
  * Output:
  *      xq: (a*X, b*Y, c*Z, d*T)
  */
-static void mul4_const(kpoint *xq, const uint16_t cons[])
+static void _ramfn(XDBLADD) mul4_const(kpoint *xq, const uint16_t cons[])
 {
    fe1271_mulconst(&xq->X, &xq->X, cons[0]);
    fe1271_mulconst(&xq->Y, &xq->Y, cons[1]);
@@ -315,6 +684,7 @@ static void mul4_const(kpoint *xq, const uint16_t cons[])
    fe1271_mulconst(&xq->T, &xq->T, cons[3]);
 }
 
+#if !CONF_XDBLADD_SHAREC
 /*
  * Pairwise multiply two tuples.
  *
@@ -324,13 +694,14 @@ static void mul4_const(kpoint *xq, const uint16_t cons[])
  * Output:
  *      xq: (X1*X2, Y1*Y2, Z1*Z2, T1*T2)
  */
-static void mul4(kpoint *xq, const kpoint *xp)
+static void _ramfn(XDBLADD) mul4(kpoint *xq, const kpoint *xp)
 {
-   fe1271_mul(&xq->X, &xq->X, &xp->X);
-   fe1271_mul(&xq->Y, &xq->Y, &xp->Y);
-   fe1271_mul(&xq->Z, &xq->Z, &xp->Z);
-   fe1271_mul(&xq->T, &xq->T, &xp->T);
+   fe1271_mulred(&xq->X, &xq->X, &xp->X);
+   fe1271_mulred(&xq->Y, &xq->Y, &xp->Y);
+   fe1271_mulred(&xq->Z, &xq->Z, &xp->Z);
+   fe1271_mulred(&xq->T, &xq->T, &xp->T);
 }
+#endif
 
 /*
  * Pairwise square a tuple.
@@ -340,17 +711,39 @@ static void mul4(kpoint *xq, const kpoint *xp)
  * Output:
  *      xq: (X^2,Y^2,Z^2,T^2)
  */
-static void sqr4(kpoint *xq, const kpoint *xp)
+static void _ramfn(XDBLADD) sqr4(kpoint *xq, const kpoint *xp)
 {
-   fe1271_square(&xq->X, &xp->X);
-   fe1271_square(&xq->Y, &xp->Y);
-   fe1271_square(&xq->Z, &xp->Z);
-   fe1271_square(&xq->T, &xp->T);
+   fe1271_sqrred(&xq->X, &xp->X);
+   fe1271_sqrred(&xq->Y, &xp->Y);
+   fe1271_sqrred(&xq->Z, &xp->Z);
+   fe1271_sqrred(&xq->T, &xp->T);
 }
 
-static const uint16_t ehat[4] = {  //
-   0x341, 0x9C3, 0x651, 0x231
-};
+#if CONF_XDBLADD_SHAREC
+/*
+ * Pairwise multiply by a shared, scaled tuple.
+ *
+ * Input:
+ *      xq: Four fe1271 elements (X1,Y1,Z1,T1)
+ *      xp: Four fe1271 elements (X2,Y2,Z2,T2)
+ *      cons: Four small (16 bits) fe1271 elements (a,b,c,d)
+ * Output:
+ *      xq: (a*X1*X2, b*Y1*Y2, c*Z1*Z2, d*T1*T2)
+ *      xp: (a*X2^2, b*Y2^2, c*Z2^2, d*T2^2)
+ */
+static void _ramfn(XDBLADD) mul4_shared(
+   kpoint *xq, kpoint *xp, const uint16_t cons[])
+{
+   fe1271 *q = &xq->X, *p = &xp->X;
+   fe1271 u;
+
+   for (int i = 0; i < 4; i++) {
+      fe1271_mulconst(&u, p + i, cons[i]);
+      fe1271_mulred(q + i, q + i, &u);
+      fe1271_mulred(p + i, p + i, &u);
+   }
+}
+#endif
 
 /*
  * Simultaneous xDBL and xADD operation on the Kummer. To deal with negated
@@ -365,25 +758,25 @@ static const uint16_t ehat[4] = {  //
  *      xp: Uncompressed Kummer point 2*xp
  *      xq: Uncompressed Kummer point xp+xq
  */
-static void xDBLADD(kpoint *xp, kpoint *xq, const kpoint *xd)
+static void _ramfn(XDBLADD) xDBLADD(kpoint *xp, kpoint *xq, const kpoint *xd)
 {
-   static const uint16_t e_cons[4] = { //
-      0x72, 0x39, 0x42, 0x1a2
-   };
-
    fe1271_hdmrd(&xq->X, &xq->X);
    fe1271_hdmrd(&xp->X, &xp->X);
+#if CONF_XDBLADD_SHAREC
+   mul4_shared(xq, xp, ehat);
+#else
    mul4(xq, xp);
    sqr4(xp, xp);
    mul4_const(xq, ehat);
    mul4_const(xp, ehat);
+#endif
    fe1271_hdmrd(&xq->X, &xq->X);
    fe1271_hdmrd(&xp->X, &xp->X);
    sqr4(xq, xq);
    sqr4(xp, xp);
-   fe1271_mul(&xq->Y, &xq->Y, &xd->Y);
-   fe1271_mul(&xq->Z, &xq->Z, &xd->Z);
-   fe1271_mul(&xq->T, &xq->T, &xd->T);
+   fe1271_mulred(&xq->Y, &xq->Y, &xd->Y);
+   fe1271_mulred(&xq->Z, &xq->Z, &xd->Z);
+   fe1271_mulred(&xq->T, &xq->T, &xd->T);
    mul4_const(xp, e_cons);
 }
 
@@ -397,10 +790,10 @@ static void xDBLADD(kpoint *xp, kpoint *xq, const kpoint *xd)
  */
 static void xUNWRAP(kpoint *xp, const kpoint *xpw)
 {
-   fe1271_mul(&xp->T, &xpw->Y, &xpw->Z);
-   fe1271_mul(&xp->Z, &xpw->Y, &xpw->T);
-   fe1271_mul(&xp->Y, &xpw->Z, &xpw->T);
-   fe1271_mul(&xp->X, &xp->T, &xpw->T);
+   fe1271_mulred(&xp->T, &xpw->Y, &xpw->Z);
+   fe1271_mulred(&xp->Z, &xpw->Y, &xpw->T);
+   fe1271_mulred(&xp->Y, &xpw->Z, &xpw->T);
+   fe1271_mulred(&xp->X, &xp->T, &xpw->T);
 }
 
 /*
@@ -415,21 +808,16 @@ static void xWRAP(kpoint *xpw, const kpoint *xp)
 {
    fe1271 w0, w1, w2, w3;
 
-   fe1271_mul(&w0, &xp->Y, &xp->Z);
-   fe1271_mul(&w1, &w0, &xp->T);
+   fe1271_mulred(&w0, &xp->Y, &xp->Z);
+   fe1271_mulred(&w1, &w0, &xp->T);
    fe1271_invert(&w2, &w1);
-   fe1271_mul(&w2, &w2, &xp->X);
-   fe1271_mul(&w3, &w2, &xp->T);
-   fe1271_mul(&xpw->Y, &w3, &xp->Z);
-   fe1271_mul(&xpw->Z, &w3, &xp->Y);
-   fe1271_mul(&xpw->T, &w0, &w2);
+   fe1271_mulred(&w2, &w2, &xp->X);
+   fe1271_mulred(&w3, &w2, &xp->T);
+   fe1271_mulred(&xpw->Y, &w3, &xp->Z);
+   fe1271_mulred(&xpw->Z, &w3, &xp->Y);
+   fe1271_mulred(&xpw->T, &w0, &w2);
 }
 
-static const uint8_t mu_1 = 0x0b;
-static const uint8_t mu_2 = 0x16;
-static const uint8_t mu_3 = 0x13;
-static const uint8_t mu_4 = 0x03;
-
 #if CONF_QDSA_FULL
 /* Conditional kpoint swap for constant-time Ladder. */
 #ifdef __thumb__
@@ -515,13 +903,13 @@ static void ct_swap(kpoint *x, kpoint *y, int b)
  *      xq: Uncompressed Kummer point
  *      xd: Wrapped Kummer point xq
  *      n: Scalar
- *      l: Maximum scalar bit-length (fixed, =250)
+ *      nb: Scalar bit-length; 251 for full scalars, 128 for H128 challenges
  * Output:
  *      xp: n*xq
  *      xq: (n+1)*xq
  */
-static void ladder_250(
-   kpoint *xp, kpoint *xq, const kpoint *xd, const uint8_t *n)
+static void ladder(
+   kpoint *xp, kpoint *xq, const kpoint *xd, const uint8_t *n, int nb)
 {
    int swap, bit, prevbit = 0;
 
@@ -531,7 +919,7 @@ static void ladder_250(
    xp->Z.v[0] = mu_3;
    xp->T.v[0] = mu_4;
 
-   for (int i = 250; i >= 0; i--) {
+   for (int i = nb - 1; i >= 0; i--) {
       bit = (n[i >> 3] >> (i & 0x07)) & 1;
       swap = bit ^ prevbit;
       prevbit = bit;
@@ -556,17 +944,10 @@ static void ladder_250(
 
 static void ladder_base_250(kpoint *xp, const uint8_t *n)
 {
-   // Wrapped base point.
-   static const kpoint bpw = {
-      .Y = { .v = { 0x4e931a48, 0xaeb351a6, 0x2049c2e7, 0x1be0c3dc } },
-      .Z = { .v = { 0xe07e36df, 0x64659818, 0x8eaba630, 0x23b416cd } },
-      .T = { .v = { 0x7215441e, 0xc7ae3d05, 0x4447a24d, 0x5db35c38 } }
-   };
-
    kpoint xq;
 
    xUNWRAP(&xq, &bpw);
-   ladder_250(xp, &xq, &bpw, n);
+   ladder(xp, &xq, &bpw, n, 251);
 }
 
 static const uint16_t q0 = 0xDF7;
@@ -578,6 +959,7 @@ static const uint16_t q5 = 0x1D33;
 static const uint16_t q6 = 0x1779;
 static const uint16_t q7 = 0xABD7;
 
+#if !CONF_QDSA_TINY || CONF_QDSA_FULL
 /*
  * Compute K_2(l1,l2,tau).
  *
@@ -592,7 +974,7 @@ static void get_k2(
    fe1271 *r, fe1271 *t, const fe1271 *l1, const fe1271 *l2, uint tau)
 {
    fe1271_mulconst(r, l1, q2);
-   fe1271_mul(r, l2, r);
+   fe1271_mulred(r, l2, r);
    if (tau) {
       fe1271_mulconst(t, l1, q0);
       fe1271_add(r, r, t);
@@ -602,14 +984,14 @@ static void get_k2(
    fe1271_mulconst(r, r, q3);
    fe1271_add(r, r, r);
    fe1271_mulconst(t, l1, q5);
-   fe1271_square(t, t);
+   fe1271_sqrred(t, t);
    fe1271_sub(r, t, r);
    fe1271_mulconst(t, l2, q3);
-   fe1271_square(t, t);
+   fe1271_sqrred(t, t);
    fe1271_add(r, t, r);
    if (tau) {
-      set_const(t, q4);
-      fe1271_square(t, t);
+      fe1271_setzero(t);
+      t->v[0] = q4 * q4;  // < 2^27
       fe1271_add(r, t, r);
    }
 }
@@ -627,8 +1009,8 @@ static void get_k2(
 static void get_k3(fe1271 *r, fe1271 *t0, fe1271 *t1, const fe1271 *l1,
    const fe1271 *l2, uint tau)
 {
-   fe1271_square(r, l1);
-   fe1271_square(t0, l2);
+   fe1271_sqrred(r, l1);
+   fe1271_sqrred(t0, l2);
 
    if (tau) {
       set_const(t1, 1);
@@ -636,9 +1018,9 @@ static void get_k3(fe1271 *r, fe1271 *t0, fe1271 *t1, const fe1271 *l1,
       fe1271_add(t0, t0, t1);
       fe1271_add(t1, r, t0);
    }
-   fe1271_mul(r, r, l2);
+   fe1271_mulred(r, r, l2);
    fe1271_mulconst(r, r, q0);
-   fe1271_mul(t0, t0, l1);
+   fe1271_mulred(t0, t0, l1);
    fe1271_mulconst(t0, t0, q1);
    fe1271_sub(r, r, t0);
    if (tau) {
@@ -650,13 +1032,16 @@ static void get_k3(fe1271 *r, fe1271 *t0, fe1271 *t1, const fe1271 *l1,
    }
    fe1271_mulconst(r, r, q3);
    if (tau) {
-      fe1271_mul(t0, l1, l2);
+      fe1271_mulred(t0, l1, l2);
       fe1271_mulconst(t0, t0, q6);
       fe1271_mulconst(t0, t0, q7);
       fe1271_sub(r, r, t0);
    }
 }
 
+#endif
+
+#if !CONF_QDSA_TINY
 /*
  * Compute K_4(l1,l2,tau).
  *
@@ -676,25 +1061,119 @@ static void get_k4(
       fe1271_sub(t, t, r);
       set_const(r, q2);
       fe1271_add(t, t, r);
-      fe1271_mul(t, t, l1);
-      fe1271_mul(t, t, l2);
+      fe1271_mulred(t, t, l1);
+      fe1271_mulred(t, t, l2);
       fe1271_mulconst(t, t, q3);
       fe1271_add(t, t, t);
       fe1271_mulconst(r, l1, q3);
-      fe1271_square(r, r);
+      fe1271_sqrred(r, r);
       fe1271_sub(t, r, t);
       fe1271_mulconst(r, l2, q5);
-      fe1271_square(r, r);
+      fe1271_sqrred(r, r);
       fe1271_add(t, r, t);
    }
    fe1271_mulconst(r, l1, q4);
-   fe1271_mul(r, r, l2);
-   fe1271_square(r, r);
+   fe1271_mulred(r, r, l2);
+   fe1271_sqrred(r, r);
    if (tau) {
       fe1271_add(r, r, t);
    }
 }
 
+#else
+/*
+ * (q5*a)^2 - 2*q3*u + (q3*b)^2, the common tail of K_2 and K_4. u may be r.
+ */
+static void get_k_tail(fe1271 *r, fe1271 *t, const fe1271 *u,
+   const fe1271 *a, const fe1271 *b)
+{
+   fe1271_mulconst(r, u, q3);
+   fe1271_add(r, r, r);
+   fe1271_mulconst(t, a, q5);
+   fe1271_sqrred(t, t);
+   fe1271_sub(r, t, r);
+   fe1271_mulconst(t, b, q3);
+   fe1271_sqrred(t, t);
+   fe1271_add(r, t, r);
+}
+
+/*
+ * K_2, K_3 and K_4 in one go, sharing l1*l2.
+ *
+ * Input:
+ *      w->X, w->Y: l1, l2
+ *      tau: Either 0 or 1
+ * Output:
+ *      k->Y, k->Z, k->T: K_2, K_3, K_4(l1,l2,tau)
+ * k->X, w->Z and w->T are clobbered.
+ */
+static void get_k(kpoint *k, kpoint *w, uint tau)
+{
+   const fe1271 *l1 = &w->X, *l2 = &w->Y;
+   fe1271 *p = &k->X, *t = &w->Z, *u = &w->T;
+
+   fe1271_mulred(p, l1, l2);
+
+   // K_2
+   fe1271_mulconst(u, p, q2);
+   if (tau) {
+      fe1271_mulconst(t, l1, q0);
+      fe1271_add(u, u, t);
+      fe1271_mulconst(t, l2, q1);
+      fe1271_sub(u, u, t);
+   }
+   get_k_tail(&k->Y, t, u, l1, l2);
+   if (tau) {
+      fe1271_setzero(t);
+      t->v[0] = q4 * q4;  // < 2^27
+      fe1271_add(&k->Y, t, &k->Y);
+   }
+
+   // K_3
+   fe1271_sqrred(&k->Z, l1);
+   fe1271_sqrred(t, l2);
+   if (tau) {
+      set_const(u, 1);
+      fe1271_add(&k->Z, &k->Z, u);
+      fe1271_add(t, t, u);
+      fe1271_add(u, &k->Z, t);
+   }
+   fe1271_mulred(&k->Z, &k->Z, l2);
+   fe1271_mulconst(&k->Z, &k->Z, q0);
+   fe1271_mulred(t, t, l1);
+   fe1271_mulconst(t, t, q1);
+   fe1271_sub(&k->Z, &k->Z, t);
+   if (tau) {
+      set_const(t, 2);
+      fe1271_sub(u, u, t);
+      fe1271_mulconst(u, u, q2);
+      fe1271_add(&k->Z, &k->Z, u);
+   }
+   fe1271_mulconst(&k->Z, &k->Z, q3);
+   if (tau) {
+      fe1271_mulconst(t, p, q6);
+      fe1271_mulconst(t, t, q7);
+      fe1271_sub(&k->Z, &k->Z, t);
+   }
+
+   // K_4
+   if (tau) {
+      fe1271_mulconst(u, l2, q0);
+      fe1271_mulconst(t, l1, q1);
+      fe1271_sub(u, u, t);
+      set_const(t, q2);
+      fe1271_add(u, u, t);
+      fe1271_mulred(u, u, p);
+      get_k_tail(u, t, u, l2, l1);
+   }
+   fe1271_mulconst(&k->T, p, q4);
+   fe1271_sqrred(&k->T, &k->T);
+   if (tau) {
+      fe1271_add(&k->T, &k->T, u);
+   }
+}
+#endif
+
 static void T_inv_row(fe1271 *r, const fe1271 *X1, const fe1271 *X2,
    const fe1271 *X3, const fe1271 *X4)
 {
@@ -722,10 +1201,17 @@ static void T_inv_row(fe1271 *r, const fe1271 *X1, const fe1271 *X2,
  */
 static void T_inv(kpoint *r, const kpoint *x)
 {
+#if CONF_QDSA_TINY
+   // Row i takes the inputs (T, Z, Y, X) with indices XOR'ed by i.
+   const fe1271 *X = &x->X;
+   for (int i = 0; i < 4; i++)
+      T_inv_row(&r->X + i, X + (3 ^ i), X + (2 ^ i), X + (1 ^ i), X + i);
+#else
    T_inv_row(&r->X, &x->T, &x->Z, &x->Y, &x->X);
    T_inv_row(&r->Y, &x->Z, &x->T, &x->X, &x->Y);
    T_inv_row(&r->Z, &x->Y, &x->X, &x->T, &x->Z);
    T_inv_row(&r->T, &x->X, &x->Y, &x->Z, &x->T);
+#endif
 }
 
 /*
@@ -749,9 +1235,13 @@ static int decompress(kpoint *r, kpoint *t, const ckpoint *x)
    r->X.b[15] &= 0x7f;
    r->Y.b[15] &= 0x7f;
 
+#if CONF_QDSA_TINY
+   get_k(t, r, tau);
+#else
    get_k2(&t->Y, &r->Z, &r->X, &r->Y, tau);
    get_k3(&t->Z, &r->Z, &r->T, &r->X, &r->Y, tau);
    get_k4(&t->T, &r->Z, &r->X, &r->Y, tau);
+#endif
 
    if (fe1271_zeroness(&t->Y) == 0)  // k2 = 0
    {
@@ -765,9 +1255,9 @@ static int decompress(kpoint *r, kpoint *t, const ckpoint *x)
             t->T.b[0] = 1;
          }
       } else if (sigma ^ t->Z.b[0]) {
-         fe1271_mul(&t->X, &t->Z, &r->X);
+         fe1271_mulred(&t->X, &t->Z, &r->X);
          fe1271_add(&t->X, &t->X, &t->X);
-         fe1271_mul(&t->Y, &t->Z, &r->Y);
+         fe1271_mulred(&t->Y, &t->Z, &r->Y);
          fe1271_add(&t->Y, &t->Y, &t->Y);
          if (tau) {
             fe1271_add(&t->Z, &t->Z, &t->Z);
@@ -778,8 +1268,8 @@ static int decompress(kpoint *r, kpoint *t, const ckpoint *x)
          return 1;
       }
    } else {
-      fe1271_square(&r->Z, &t->Z);
-      fe1271_mul(&r->T, &t->Y, &t->T);
+      fe1271_sqrred(&r->Z, &t->Z);
+      fe1271_mulred(&r->T, &t->Y, &t->T);
       fe1271_sub(&r->Z, &r->Z, &r->T);
       if (fe1271_has_sqrt(&r->T, &t->X, &r->Z, sigma)) {
          return 1;
@@ -790,17 +1280,13 @@ static int decompress(kpoint *r, kpoint *t, const ckpoint *x)
       } else {
          fe1271_setzero(&t->Z);
       }
-      fe1271_mul(&t->X, &t->Y, &r->X);
-      fe1271_mul(&t->Y, &t->Y, &r->Y);
+      fe1271_mulred(&t->X, &t->Y, &r->X);
+      fe1271_mulred(&t->Y, &t->Y, &r->Y);
    }
    T_inv(r, t);
    return 0;
 }
 
-static const uint16_t muhat[4] = {  //
-   0x0021, 0x000B, 0x0011, 0x0031
-};
-
 /*
  * Compute the Hadamard transform on four fe1271 elements.
  *
@@ -819,6 +1305,11 @@ static void fe1271_H(fe1271 *x)
    fe1271_neg(x + 3);
 }
 
+/* Small constants of the second dot product of B_ii; see dot_const(). */
+static const uint16_t dotc[4] = { 0x1259, 0x173F, 0x1679, 0x07C7 };
+
+#if !CONF_QDSA_CHECKX
+#if !CONF_QDSA_TINY
 /*
  * Compute the dot product of two tuples.
  *
@@ -834,12 +1325,12 @@ static void dot(fe1271 *r, const fe1271 *x0, const fe1271 *x1, const fe1271 *x2,
 {
    fe1271 t;
 
-   fe1271_mul(r, x0, y0);
-   fe1271_mul(&t, x1, y1);
+   fe1271_mulred(r, x0, y0);
+   fe1271_mulred(&t, x1, y1);
    fe1271_add(r, r, &t);
-   fe1271_mul(&t, x2, y2);
+   fe1271_mulred(&t, x2, y2);
    fe1271_add(r, r, &t);
-   fe1271_mul(&t, x3, y3);
+   fe1271_mulred(&t, x3, y3);
    fe1271_add(r, r, &t);
 }
 
@@ -856,21 +1347,17 @@ static void dot(fe1271 *r, const fe1271 *x0, const fe1271 *x1, const fe1271 *x2,
 static void dot_const(fe1271 *r, const fe1271 *x0, const fe1271 *x1,
    const fe1271 *x2, const fe1271 *x3)
 {
-   static const uint16_t k1 = 0x1259;
-   static const uint16_t k2 = 0x173F;
-   static const uint16_t k3 = 0x1679;
-   static const uint16_t k4 = 0x07C7;
-
    fe1271 t;
 
-   fe1271_mulconst(r, x0, k1);
-   fe1271_mulconst(&t, x1, k2);
+   fe1271_mulconst(r, x0, dotc[0]);
+   fe1271_mulconst(&t, x1, dotc[1]);
    fe1271_sub(r, r, &t);
-   fe1271_mulconst(&t, x2, k3);
+   fe1271_mulconst(&t, x2, dotc[2]);
    fe1271_sub(r, r, &t);
-   fe1271_mulconst(&t, x3, k4);
+   fe1271_mulconst(&t, x3, dotc[3]);
    fe1271_add(r, r, &t);
 }
+#endif
 
 /*
  * Four quadratic forms B_{ii} on the Kummer, where 1 <= i <= 4.
@@ -890,62 +1377,80 @@ static void bii_values(
    mul4_const(r, ehat);
    fe1271_neg(&t0->X);
    fe1271_neg(&r->X);
-   dot(&t1->X, &t0->X, &t0->Y, &t0->Z, &t0->T, &r->X, &r->Y, &r->Z, &r->T);
-   dot(&t1->Y, &t0->X, &t0->Y, &t0->Z, &t0->T, &r->Y, &r->X, &r->T, &r->Z);
-   dot(&t1->Z, &t0->X, &t0->Z, &t0->Y, &t0->T, &r->Z, &r->X, &r->T, &r->Y);
-   dot(&t1->T, &t0->X, &t0->T, &t0->Y, &t0->Z, &r->T, &r->X, &r->Z, &r->Y);
-   dot_const(&r->X, &t1->X, &t1->Y, &t1->Z, &t1->T);
-   dot_const(&r->Y, &t1->Y, &t1->X, &t1->T, &t1->Z);
-   dot_const(&r->Z, &t1->Z, &t1->T, &t1->X, &t1->Y);
+#if CONF_QDSA_TINY
+   // Row i of both dot products pairs element k with element k^i.
+   fe1271 *a = &t0->X, *b = &r->X, *d = &t1->X, t;
+
+   for (int i = 0; i < 4; i++) {
+      fe1271_mulred(d + i, a, b + i);
+      for (int k = 1; k < 4; k++) {
+         fe1271_mulred(&t, a + k, b + (k ^ i));
+         fe1271_add(d + i, d + i, &t);
+      }
+   }
+   for (int i = 0; i < 4; i++) {
+      fe1271_mulconst(b + i, d + i, dotc[0]);
+      for (int k = 1; k < 4; k++) {
+         fe1271_mulconst(&t, d + (k ^ i), dotc[k]);
+         if (k == 3)
+            fe1271_add(b + i, b + i, &t);
+         else
+            fe1271_sub(b + i, b + i, &t);
+      }
+   }
+#else
+   dot(&t1->X, &t0->X, &t0->Y, &t0->Z, &t0->T, &r->X, &r->Y, &r->Z, &r->T);
+   dot(&t1->Y, &t0->X, &t0->Y, &t0->Z, &t0->T, &r->Y, &r->X, &r->T, &r->Z);
+   dot(&t1->Z, &t0->X, &t0->Z, &t0->Y, &t0->T, &r->Z, &r->X, &r->T, &r->Y);
+   dot(&t1->T, &t0->X, &t0->T, &t0->Y, &t0->Z, &r->T, &r->X, &r->Z, &r->Y);
+   dot_const(&r->X, &t1->X, &t1->Y, &t1->Z, &t1->T);
+   dot_const(&r->Y, &t1->Y, &t1->X, &t1->T, &t1->Z);
+   dot_const(&r->Z, &t1->Z, &t1->T, &t1->X, &t1->Y);
    dot_const(&r->T, &t1->T, &t1->Z, &t1->Y, &t1->X);
+#endif
    mul4_const(r, muhat);
    fe1271_neg(&r->X);
 }
 
+#endif
+
+
+#if !CONF_QDSA_CHECKX
 /*
  * Quadratic form B_{ij} on the Kummer, where (P1,P2,P3,P4), (Q1,Q2,Q3,Q4) are
- * some permutation of the coordinates of two Kummer points P and Q, and
- * (c1,c2,c3,c4) is a permutation of curve constants depending of the choice of
- * {i,j}.
+ * some permutation of the coordinates of two Kummer points P and Q, and k holds
+ * the folded constants for the choice of {i,j}.
  *
  * Input:
  *      (P1,P2,P3,P4): Permutation of coordinates of P
  *      (Q1,Q2,Q3,Q4): Permutation of coordinates of Q
- *      (c1,c2,c3,c4): Permutation of curve constants
+ *      k: Folded constants, see bijconst
  * Output:
- *      r: B_{ij}
+ *      r: ±2C*B_{ij}
  */
 static void bij_value(fe1271 *r, kpoint *t, const fe1271 *P1, const fe1271 *P2,
    const fe1271 *P3, const fe1271 *P4, const fe1271 *Q1, const fe1271 *Q2,
-   const fe1271 *Q3, const fe1271 *Q4, uint16_t c1, uint16_t c2, uint16_t c3,
-   uint16_t c4)
+   const fe1271 *Q3, const fe1271 *Q4, const bijconst *k)
 {
-   fe1271_mul(r, P1, P2);
-   fe1271_mul(&t->X, Q1, Q2);
-   fe1271_mul(&t->Y, P3, P4);
+   fe1271_mulred(r, P1, P2);
+   fe1271_mulred(&t->X, Q1, Q2);
+   fe1271_mulred(&t->Y, P3, P4);
    fe1271_sub(r, r, &t->Y);
-   fe1271_mul(&t->Z, Q3, Q4);
+   fe1271_mulred(&t->Z, Q3, Q4);
    fe1271_sub(&t->X, &t->X, &t->Z);
-   fe1271_mul(r, r, &t->X);
-   fe1271_mul(&t->X, &t->Y, &t->Z);
-   fe1271_mulconst(r, r, c3);
-   fe1271_mulconst(r, r, c4);
-   fe1271_sum(&t->Y, &t->Z, c3, c4, c1, c2);
-   fe1271_mul(&t->X, &t->X, &t->Y);
+   fe1271_mulred(r, r, &t->X);
+   fe1271_mulred(&t->X, &t->Y, &t->Z);
+   fe1271_mulconst(r, r, k->c34);
+   fe1271_mulconst(&t->X, &t->X, k->c1234);
    fe1271_sub(r, &t->X, r);
-   fe1271_mulconst(r, r, c1);
-   fe1271_mulconst(r, r, c2);
-   fe1271_sum(&t->Y, &t->Z, c2, c4, c1, c3);
-   fe1271_mul(r, r, &t->Y);
-   fe1271_sum(&t->Y, &t->Z, c2, c3, c1, c4);
-   fe1271_mul(r, r, &t->Y);
+   fe1271_mulred(r, r, &k->K);
 }
 
 /*
  * Verify whether  BjjR1^2 - 2*C*BijR1R2 + BiiR2^2 = 0.
  *
  * Input:
- *      Bij: Biquadratic form Bij
+ *      Bij: Biquadratic form Bij, pre-multiplied by 2*C
  *      Bjj: Biquadratic form Bjj
  *      Bii: Biquadratic form Bii
  *      R1: Coordinate of Kummer point R
@@ -957,20 +1462,13 @@ static void bij_value(fe1271 *r, kpoint *t, const fe1271 *P1, const fe1271 *P2,
 static int quad(fe1271 *Bij, kpoint *t, const fe1271 *Bjj, const fe1271 *Bii,
    const fe1271 *R1, const fe1271 *R2)
 {
-   static const fe1271 C = { //
-      .b = { 0x43, 0xA8, 0xDD, 0xCD, 0xD8, 0xE3, 0xF7, 0x46, 0xDD, 0xA2, 0x20,
-         0xA3, 0xEF, 0x0E, 0xF5, 0x40 }
-   };
-
-   fe1271_square(&t->X, R1);
-   fe1271_mul(&t->X, Bjj, &t->X);
-   fe1271_mul(&t->Y, R1, R2);
-   fe1271_mul(&t->Y, Bij, &t->Y);
-   fe1271_mul(&t->Y, &C, &t->Y);
-   fe1271_add(&t->Y, &t->Y, &t->Y);
+   fe1271_sqrred(&t->X, R1);
+   fe1271_mulred(&t->X, Bjj, &t->X);
+   fe1271_mulred(&t->Y, R1, R2);
+   fe1271_mulred(&t->Y, Bij, &t->Y);
    fe1271_sub(&t->X, &t->X, &t->Y);
-   fe1271_square(&t->Y, R2);
-   fe1271_mul(&t->Y, Bii, &t->Y);
+   fe1271_sqrred(&t->Y, R2);
+   fe1271_mulred(&t->Y, Bii, &t->Y);
    fe1271_add(&t->X, &t->X, &t->Y);
    return fe1271_zeroness(&t->X);
 }
@@ -1000,33 +1498,67 @@ static int check(kpoint *sP, kpoint *hQ, kpoint *R, kpoint *t, ckpoint *xr)
    fe1271_H(&R->X);
    // B12
    bij_value(&Bij, t, &sP->X, &sP->Y, &sP->Z, &sP->T, &hQ->X, &hQ->Y, &hQ->Z,
-      &hQ->T, muhat[0], muhat[1], muhat[2], muhat[3]);
+      &hQ->T, &bijc[0]);
    v |= quad(&Bij, t, &Bii.Y, &Bii.X, &R->X, &R->Y);
    // B13
    bij_value(&Bij, t, &sP->X, &sP->Z, &sP->Y, &sP->T, &hQ->X, &hQ->Z, &hQ->Y,
-      &hQ->T, muhat[0], muhat[2], muhat[1], muhat[3]);
+      &hQ->T, &bijc[1]);
    v |= quad(&Bij, t, &Bii.Z, &Bii.X, &R->X, &R->Z);
    // B14
    bij_value(&Bij, t, &sP->X, &sP->T, &sP->Y, &sP->Z, &hQ->X, &hQ->T, &hQ->Y,
-      &hQ->Z, muhat[0], muhat[3], muhat[1], muhat[2]);
+      &hQ->Z, &bijc[2]);
    v |= quad(&Bij, t, &Bii.T, &Bii.X, &R->X, &R->T);
    // B23
    bij_value(&Bij, t, &sP->Y, &sP->Z, &sP->X, &sP->T, &hQ->Y, &hQ->Z, &hQ->X,
-      &hQ->T, muhat[1], muhat[2], muhat[0], muhat[3]);
-   fe1271_neg(&Bij);
+      &hQ->T, &bijc[3]);
    v |= quad(&Bij, t, &Bii.Z, &Bii.Y, &R->Y, &R->Z);
    // B24
    bij_value(&Bij, t, &sP->Y, &sP->T, &sP->X, &sP->Z, &hQ->Y, &hQ->T, &hQ->X,
-      &hQ->Z, muhat[1], muhat[3], muhat[0], muhat[2]);
-   fe1271_neg(&Bij);
+      &hQ->Z, &bijc[4]);
    v |= quad(&Bij, t, &Bii.T, &Bii.Y, &R->Y, &R->T);
    // B34
    bij_value(&Bij, t, &sP->Z, &sP->T, &sP->X, &sP->Y, &hQ->Z, &hQ->T, &hQ->X,
-      &hQ->Y, muhat[2], muhat[3], muhat[0], muhat[1]);
-   fe1271_neg(&Bij);
+      &hQ->Y, &bijc[5]);
    v |= quad(&Bij, t, &Bii.T, &Bii.Z, &R->Z, &R->T);
    return v;
 }
+#endif
+
+#if CONF_QDSA_LANES && (CONF_QDSA_FULL || CONF_QDSA_CHECKX)
+#include "lanes.inc"
+#endif
+
+#if CONF_QDSA_PROF
+static uint64_t prof_cyc[QDSA_PH_NUM];
+static uint32_t prof_t0;
+
+/* Charge the time since the previous mark to phase ph. */
+static void prof_mark(int ph)
+{
+   uint32_t t = prof_clock();
+
+   prof_cyc[ph] += t - prof_t0;
+   prof_t0 = t;
+}
+
+void qdsa_prof_get(uint64_t cyc[QDSA_PH_NUM])
+{
+   for (int i = 0; i < QDSA_PH_NUM; i++)
+      cyc[i] = prof_cyc[i];
+}
+
+void qdsa_prof_reset(void)
+{
+   for (int i = 0; i < QDSA_PH_NUM; i++)
+      prof_cyc[i] = 0;
+}
+
+#define PROF_START() (prof_t0 = prof_clock())
+#define PROF_MARK(ph) prof_mark(QDSA_PH_##ph)
+#else
+#define PROF_START()
+#define PROF_MARK(ph)
+#endif
 
 static void scalar_get_hrqm(
    fe1271 *z, const uint8_t *r, const uint8_t *q, const uint8_t *m)
@@ -1037,15 +1569,427 @@ static void scalar_get_hrqm(
    bobjr_absorb_wa(&ctx, q, 32);  // Q, the public key.
    bobjr_absorb_wa(&ctx, m, 32);  // M, the message.
    bobjr_finish_wa(&ctx);         // 64B H(R||Q||M) ready in state.
-   large_red(z->v, (uint32_t *)ctx.state);
+   scalar_red(z->v, (uint32_t *)ctx.state);
 }
 
+#if CONF_QDSA_H128
+/* h = H(tag||R||Q||M), truncated to 128 bits; 16 upper bytes are cleared. */
+static void scalar_get_h128(
+   fe1271 *z, const uint8_t *r, const uint8_t *q, const uint8_t *m)
+{
+   // "qH" + challenge length 0x80 (128 bits) + variant version 1.
+   static const uint8_t _align4 tag[4] = { 'q', 'H', 0x80, 0x01 };
+
+   bobjr_ctx ctx;
+   bobjr_init(&ctx);
+   bobjr_absorb_wa(&ctx, tag, 4);
+   bobjr_absorb_wa(&ctx, r, 32);
+   bobjr_absorb_wa(&ctx, q, 32);
+   bobjr_absorb_wa(&ctx, m, 32);
+   bobjr_finish_wa(&ctx);
+   wam_copy(z, ctx.state, 16);
+   fe1271_setzero(z + 1);
+}
+#endif
+
 static void scalar_get32(uint32_t *r, const uint8_t *x)
 {
    uint32_t t[16];
    wam_copy(t, x, 32);
    wam_zero(&t[8], 32);
-   large_red(r, t);
+   scalar_red(r, t);
+}
+
+#if CONF_QDSA_XTAB
+/* -----------------------------------------------------------------------------
+ * Jacobian of C: y^2 = x^5 + f4 x^4 + f3 x^3 + f2 x^2 + f1 x, for the
+ * fixed-base tables. Variable time, like the verifier Ladder. Weight-1 and
+ * other special divisors are not handled: the functions return 1 and the
+ * caller falls back to the Ladder. The comb has 4-bit signed digits in -7..8,
+ * so row i of a table holds [k 16^i]Q for k = 1..8; 63 rows cover h < 2^251.
+ */
+#define XTAB_ROWS 63
+
+typedef char qdsa_xtab_len_ok[
+   XTAB_ROWS * 8 * sizeof(jpoint) == QDSA_XTAB_LEN ? 1 : -1];
+
+/* jpoint in projective form: u1 = U1/Z etc., 80B/20W. */
+typedef struct {
+   fe1271 U1;
+   fe1271 U0;
+   fe1271 V1;
+   fe1271 V0;
+   fe1271 Z;
+} _align4 jpointz;
+
+static void jset(jpointz *p, const jpoint *q)
+{
+   wam_copy(p, q, sizeof(jpoint));
+   set_const(&p->Z, 1);
+}
+
+/*
+ * p += ±q, mixed addition (45 MUL). Return 1 if the inputs share a root of u
+ * or the sum has weight 1, with p destroyed.
+ */
+static int jadd(jpointz *p, const jpoint *q, int neg)
+{
+   fe1271 a, b, c, d, z1, z2, z3, r, w0, w1, s1, s0, t, u;
+   fe1271 s1s, s0z, ssz, r2z, zs1, dz, k, n1, n0, e, y;
+
+   fe1271_mulred(&a, &q->u1, &p->Z);
+   fe1271_mulred(&b, &q->u0, &p->Z);
+   fe1271_mulred(&c, &q->v0, &p->Z);
+   fe1271_mulred(&d, &q->v1, &p->Z);
+   if (neg) {
+      fe1271_neg(&c);
+      fe1271_neg(&d);
+   }
+   fe1271_sub(&z1, &p->U1, &a);
+   fe1271_sub(&z2, &b, &p->U0);
+   fe1271_mulred(&z3, &p->U1, &z1);
+   fe1271_mulred(&t, &z2, &p->Z);
+   fe1271_add(&z3, &z3, &t);
+   fe1271_mulred(&r, &z2, &z3);
+   fe1271_sqrred(&t, &z1);
+   fe1271_mulred(&t, &t, &p->U0);
+   fe1271_add(&r, &r, &t);  // resultant of the u's, times Z^3
+   fe1271_sub(&w0, &p->V0, &c);
+   fe1271_sub(&w1, &p->V1, &d);
+   fe1271_mulred(&s1, &w0, &p->Z);
+   fe1271_mulred(&t, &w1, &p->U1);
+   fe1271_sub(&s1, &s1, &t);
+   fe1271_mulred(&s1, &s1, &z1);
+   fe1271_mulred(&t, &z3, &w1);
+   fe1271_add(&s1, &s1, &t);
+   fe1271_mulred(&t, &z1, &w1);
+   fe1271_mulred(&t, &t, &p->U0);
+   fe1271_mulred(&s0, &z3, &w0);
+   fe1271_sub(&s0, &s0, &t);  // s = (S1 x + S0)/R
+   if (fe1271_zeroness(&r) == 0 || fe1271_zeroness(&s1) == 0) {
+      return 1;
+   }
+
+   fe1271_sqrred(&s1s, &s1);
+   fe1271_mulred(&s0z, &s0, &p->Z);
+   fe1271_mulred(&ssz, &s0z, &s1);
+   fe1271_sqrred(&r2z, &r);
+   fe1271_mulred(&r2z, &r2z, &p->Z);
+   fe1271_mulred(&zs1, &p->Z, &s1);
+   fe1271_mulred(&dz, &zs1, &s1);
+   fe1271_mulred(&k, &r, &zs1);
+   fe1271_add(&n1, &ssz, &ssz);
+   fe1271_mulred(&t, &z1, &s1s);
+   fe1271_sub(&n1, &n1, &t);
+   fe1271_sub(&n1, &n1, &r2z);
+   fe1271_mulred(&e, &p->U1, &s1s);
+   fe1271_sub(&e, &e, &ssz);
+   fe1271_add(&e, &e, &r2z);
+   fe1271_mulred(&y, &d, &k);
+   fe1271_sqrred(&n0, &s0z);
+   fe1271_mulred(&t, &ssz, &z1);
+   fe1271_add(&t, &t, &t);
+   fe1271_sub(&n0, &n0, &t);
+   fe1271_mulred(&t, &s1s, &z3);
+   fe1271_add(&n0, &n0, &t);
+   fe1271_add(&n0, &n0, &y);
+   fe1271_add(&n0, &n0, &y);
+   fe1271_mulred(&t, &jf[3], &p->Z);
+   fe1271_sub(&t, &a, &t);
+   fe1271_add(&t, &t, &p->U1);
+   fe1271_mulred(&t, &t, &r2z);
+   fe1271_add(&n0, &n0, &t);
+
+   fe1271_mulred(&u, &a, &ssz);
+   fe1271_sub(&u, &n0, &u);
+   fe1271_mulred(&t, &b, &dz);
+   fe1271_sub(&u, &u, &t);
+   fe1271_sub(&u, &u, &y);
+   fe1271_mulred(&u, &u, &dz);
+   fe1271_mulred(&t, &n1, &e);
+   fe1271_mulred(&t, &t, &p->Z);
+   fe1271_add(&p->V1, &t, &u);
+   fe1271_mulred(&u, &b, &ssz);
+   fe1271_mulred(&t, &c, &k);
+   fe1271_add(&u, &u, &t);
+   fe1271_mulred(&u, &u, &dz);
+   fe1271_mulred(&t, &n0, &e);
+   fe1271_sub(&p->V0, &t, &u);
+   fe1271_mulred(&t, &k, &p->Z);
+   fe1271_mulred(&p->U1, &n1, &t);
+   fe1271_mulred(&p->U0, &n0, &k);
+   fe1271_mulred(&p->Z, &dz, &t);
+   return 0;
+}
+
+/*
+ * r = 2p, affine, with two inversions; for building tables only. Return 1 if
+ * the double is special.
+ */
+static int jdbl(jpoint *r, const jpoint *p)
+{
+   fe1271 n, q2, q1, q0, k1, k0, w0, s1, s0, l2, l1, l0, t, i;
+
+   // n = v0^2 - v0 v1 u1 + v1^2 u0, resultant of u and v.
+   fe1271_mulred(&w0, &p->v1, &p->u1);
+   fe1271_sub(&w0, &p->v0, &w0);
+   fe1271_mulred(&n, &p->v0, &w0);
+   fe1271_sqrred(&t, &p->v1);
+   fe1271_mulred(&i, &t, &p->u0);
+   fe1271_add(&n, &n, &i);
+   // (f - v^2)/u = x^3 + q2 x^2 + q1 x + q0, then k = that mod u.
+   fe1271_sub(&q2, &jf[3], &p->u1);
+   fe1271_mulred(&q1, &p->u1, &q2);
+   fe1271_sub(&q1, &jf[2], &q1);
+   fe1271_sub(&q1, &q1, &p->u0);
+   fe1271_sub(&q0, &jf[1], &t);
+   fe1271_mulred(&t, &p->u0, &q2);
+   fe1271_sub(&q0, &q0, &t);
+   fe1271_mulred(&t, &p->u1, &q1);
+   fe1271_sub(&q0, &q0, &t);
+   fe1271_sqrred(&k1, &p->u1);
+   fe1271_sub(&k1, &k1, &p->u0);
+   fe1271_mulred(&t, &q2, &p->u1);
+   fe1271_sub(&k1, &k1, &t);
+   fe1271_add(&k1, &k1, &q1);
+   fe1271_sub(&k0, &p->u1, &q2);
+   fe1271_mulred(&k0, &k0, &p->u0);
+   fe1271_add(&k0, &k0, &q0);
+   // s = k/2v mod u, with 1/v = (w0 - v1 x)/n.
+   fe1271_add(&t, &n, &n);
+   if (fe1271_zeroness(&t) == 0) {
+      return 1;
+   }
+   fe1271_invert(&i, &t);
+   fe1271_mulred(&s1, &k1, &w0);
+   fe1271_mulred(&t, &k0, &p->v1);
+   fe1271_sub(&s1, &s1, &t);
+   fe1271_mulred(&t, &k1, &p->v1);
+   fe1271_mulred(&s0, &t, &p->u1);
+   fe1271_add(&s1, &s1, &s0);
+   fe1271_mulred(&s1, &s1, &i);
+   fe1271_mulred(&t, &t, &p->u0);
+   fe1271_mulred(&s0, &k0, &w0);
+   fe1271_add(&s0, &s0, &t);
+   fe1271_mulred(&s0, &s0, &i);
+   if (fe1271_zeroness(&s1) == 0) {
+      return 1;
+   }
+   // l = s u + v = s1 x^3 + l2 x^2 + l1 x + l0.
+   fe1271_mulred(&l2, &s1, &p->u1);
+   fe1271_add(&l2, &l2, &s0);
+   fe1271_mulred(&l1, &s1, &p->u0);
+   fe1271_mulred(&t, &s0, &p->u1);
+   fe1271_add(&l1, &l1, &t);
+   fe1271_add(&l1, &l1, &p->v1);
+   fe1271_mulred(&l0, &s0, &p->u0);
+   fe1271_add(&l0, &l0, &p->v0);
+   // u' = (l^2 - f)/u^2, monic: the top three coefficients over s1^2.
+   fe1271_sqrred(&k0, &s1);           // e6
+   fe1271_mulred(&k1, &s1, &l2);
+   fe1271_add(&k1, &k1, &k1);
+   set_const(&t, 1);
+   fe1271_sub(&k1, &k1, &t);          // e5
+   fe1271_sqrred(&q0, &l2);
+   fe1271_mulred(&t, &s1, &l1);
+   fe1271_add(&t, &t, &t);
+   fe1271_add(&q0, &q0, &t);
+   fe1271_sub(&q0, &q0, &jf[3]);      // e4
+   fe1271_mulred(&t, &p->u1, &k0);
+   fe1271_add(&t, &t, &t);
+   fe1271_sub(&k1, &k1, &t);          // q1 = e5 - 2 u1 e6
+   fe1271_sqrred(&t, &p->u1);
+   fe1271_add(&t, &t, &p->u0);
+   fe1271_add(&t, &t, &p->u0);
+   fe1271_mulred(&t, &t, &k0);
+   fe1271_sub(&q0, &q0, &t);
+   fe1271_mulred(&t, &p->u1, &k1);
+   fe1271_add(&t, &t, &t);
+   fe1271_sub(&q0, &q0, &t);          // q0 = e4 - (u1^2 + 2 u0) e6 - 2 u1 q1
+   fe1271_invert(&i, &k0);
+   fe1271_mulred(&r->u1, &k1, &i);
+   fe1271_mulred(&r->u0, &q0, &i);
+   // v' = -(l mod u').
+   fe1271_sqrred(&t, &r->u1);
+   fe1271_sub(&t, &t, &r->u0);
+   fe1271_mulred(&t, &t, &s1);
+   fe1271_mulred(&i, &l2, &r->u1);
+   fe1271_sub(&t, &i, &t);
+   fe1271_sub(&r->v1, &t, &l1);
+   fe1271_mulred(&t, &s1, &r->u1);
+   fe1271_sub(&t, &l2, &t);
+   fe1271_mulred(&t, &t, &r->u0);
+   fe1271_sub(&r->v0, &t, &l0);
+   return 0;
+}
+
+/* p[0..n-1] to affine with one inversion, n <= 8. */
+static void jnorm(jpoint *r, const jpointz *p, int n)
+{
+   fe1271 c[8], t, u;
+   int k;
+
+   fe1271_copy(&c[0], &p[0].Z);
+   for (k = 1; k < n; k++)
+      fe1271_mulred(&c[k], &c[k - 1], &p[k].Z);
+   fe1271_invert(&t, &c[n - 1]);
+   for (k = n - 1; k >= 0; k--) {
+      if (k > 0) {
+         fe1271_mulred(&u, &t, &c[k - 1]);
+         fe1271_mulred(&t, &t, &p[k].Z);
+      } else {
+         fe1271_copy(&u, &t);
+      }
+      fe1271_mulred(&r[k].u1, &p[k].U1, &u);
+      fe1271_mulred(&r[k].u0, &p[k].U0, &u);
+      fe1271_mulred(&r[k].v1, &p[k].V1, &u);
+      fe1271_mulred(&r[k].v0, &p[k].V0, &u);
+   }
+}
+
+/* r = m x; r must not alias x. */
+static void jmat(fe1271 *r, const fe1271 m[4][4], const fe1271 *x)
+{
+   fe1271 t;
+   int i, j;
+
+   for (i = 0; i < 4; i++) {
+      fe1271_mulred(&r[i], &m[i][0], &x[0]);
+      for (j = 1; j < 4; j++) {
+         fe1271_mulred(&t, &m[i][j], &x[j]);
+         fe1271_add(&r[i], &r[i], &t);
+      }
+   }
+}
+
+/* r = Z^3 F0(-U1/Z, U0/Z), the part of xi_4 from f; see qgen.cpp. */
+static void jf0(
+   fe1271 *r, const fe1271 *U1, const fe1271 *U0, const fe1271 *Z)
+{
+   fe1271 t, u;
+
+   fe1271_mulred(&t, &jf[1], U0);
+   fe1271_add(&t, &t, &t);
+   fe1271_mulred(&u, &jf[0], U1);
+   fe1271_sub(&t, &t, &u);
+   fe1271_mulred(&t, &t, Z);
+   fe1271_mulred(r, &jf[3], U0);
+   fe1271_add(r, r, r);
+   fe1271_mulred(&u, &jf[2], U1);
+   fe1271_sub(r, r, &u);
+   fe1271_mulred(r, r, U0);
+   fe1271_add(r, r, &t);
+   fe1271_mulred(r, r, Z);
+   fe1271_sqrred(&t, U0);
+   fe1271_mulred(&t, &t, U1);
+   fe1271_sub(r, r, &t);
+}
+
+/* The Kummer point of ±p: Cassels-Flynn coordinates, then jM. */
+static void jtok(kpoint *k, const jpointz *p)
+{
+   fe1271 xi[4], dd, t;
+
+   fe1271_mulred(&t, &p->U0, &p->Z);
+   fe1271_add(&t, &t, &t);
+   fe1271_add(&t, &t, &t);
+   fe1271_sqrred(&dd, &p->U1);
+   fe1271_sub(&dd, &dd, &t);
+   fe1271_mulred(&xi[0], &p->Z, &dd);
+   fe1271_mulred(&xi[1], &p->U1, &dd);
+   fe1271_neg(&xi[1]);
+   fe1271_mulred(&xi[2], &p->U0, &dd);
+   // xi_4 = Z^3 F0 - 2 (V1 (V1 U0 - V0 U1) + V0^2 Z)
+   fe1271_mulred(&t, &p->V1, &p->U0);
+   fe1271_mulred(&dd, &p->V0, &p->U1);
+   fe1271_sub(&t, &t, &dd);
+   fe1271_mulred(&t, &t, &p->V1);
+   fe1271_sqrred(&dd, &p->V0);
+   fe1271_mulred(&dd, &dd, &p->Z);
+   fe1271_add(&t, &t, &dd);
+   fe1271_add(&t, &t, &t);
+   jf0(&xi[3], &p->U1, &p->U0, &p->Z);
+   fe1271_sub(&xi[3], &xi[3], &t);
+   jmat((fe1271 *)k, jM, xi);
+}
+
+/*
+ * [h]Q on the Kummer from the table of Q; h has hb bits. Return 1 if the comb
+ * hits a special divisor, or h = 0; hQ is then for the Ladder to fill.
+ */
+static int xtab_mul(kpoint *hQ, const jpoint *tab, const uint8_t *h, int hb)
+{
+   jpointz acc;
+   const jpoint *e;
+   int i, d, carry = 0, first = 1;
+
+   for (i = 0; i <= hb / 4 && i < XTAB_ROWS; i++) {
+      d = (h[i >> 1] >> (4 * (i & 1)) & 15) + carry;
+      carry = d > 8;
+      d -= carry << 4;
+      if (d == 0) continue;
+      e = &tab[8 * i + (d < 0 ? -d : d) - 1];
+      if (first) {
+         jset(&acc, e);
+         if (d < 0) {
+            fe1271_neg(&acc.V1);
+            fe1271_neg(&acc.V0);
+         }
+         first = 0;
+      } else if (jadd(&acc, e, d < 0)) {
+         return 1;
+      }
+   }
+   if (first || carry) {
+      return 1;
+   }
+   jtok(hQ, &acc);
+   return 0;
+}
+#endif  // CONF_QDSA_XTAB
+
+/*
+ * Common tail of the verifiers: hash, both Ladders and the final check.
+ *
+ * Input:
+ *      sP: Uncompressed public key point Q; destroyed
+ *      qw: Wrapped public key point; only Y, Z, T are read
+ *      tab: Fixed-base table of Q for [h]Q, or NULL for the Ladder
+ *      t: Scratch point; may alias qw
+ *      hb: Challenge bit-length, 251 or 128 (H128 variant)
+ *      stop: If not NULL, give up with -1 when *stop is set between Ladders
+ */
+static int verify_tail(const uint8_t *sig, const uint8_t *pk,
+   const uint8_t *msg, kpoint *sP, kpoint *hQ, const kpoint *qw,
+   const jpoint *tab, kpoint *t, int hb, const volatile uint32_t *stop)
+{
+   kpoint R;
+   int res;
+
+   scalar_get32(R.X.v, sig + 32);  // 2nd half sig: s in R.X, R.Y.
+#if CONF_QDSA_H128
+   if (hb == 128)
+      scalar_get_h128(&R.Z, sig, pk, msg);
+   else
+#endif
+      scalar_get_hrqm(&R.Z, sig, pk, msg);  // h = H(R||Q||M) in R.Z, R.T.
+   PROF_MARK(SCALAR);
+
+#if CONF_QDSA_XTAB
+   if (tab == NULL || xtab_mul(hQ, tab, R.Z.b, hb))
+#endif
+      ladder(hQ, sP, qw, R.Z.b, hb);  // [h]Q
+   PROF_MARK(LADDER);
+   if (stop && *stop) return -1;
+   ladder_base_250(sP, R.X.b);  // [s]P
+   PROF_MARK(LADDER_BASE);
+#if CONF_QDSA_CHECKX
+   res = check_x(sP, hQ, &R, t, (ckpoint *)sig);
+#else
+   res = check(sP, hQ, &R, t, (ckpoint *)sig);
+#endif
+   PROF_MARK(CHECK);
+   return res;
 }
 
 /* -----------------------------------------------------------------------------
@@ -1056,56 +2000,461 @@ static void scalar_get32(uint32_t *r, const uint8_t *x)
  *      sig (64 bytes): Signature
  *      pkey (32 bytes): Public key
  *      msg (32 bytes): Message, 32B fixed size
+ *      hb: Challenge bit-length, 251; or 128 for H128
  * Output:
  *      0 if correct, 1 if incorrect
  */
+static int verify(const uint8_t *sig, const uint8_t *pk, const uint8_t *msg,
+   int hb)
+{
+   kpoint sP, hQ, pxw;
+
+   PROF_START();
+   if (decompress(&sP, &hQ, (const ckpoint *)pk)) {
+      return 1;
+   }
+   PROF_MARK(DECOMPRESS);
+   xWRAP(&pxw, &sP);
+   PROF_MARK(WRAP);
+   return verify_tail(sig, pk, msg, &sP, &hQ, &pxw, NULL, &pxw, hb, NULL);
+}
+
 int qdsa_verify(
    const uint8_t sig[64], const uint8_t pk[32], const uint8_t msg[32])
 {
-   kpoint sP, hQ, R, pxw;
+   return verify(sig, pk, msg, 251);
+}
 
-   if (decompress(&sP, &hQ, (const ckpoint *)pk)) {
+#if CONF_QDSA_H128
+/* -----------------------------------------------------------------------------
+ * Verify an H128 signature; see CONF_QDSA_H128. Same interface as above.
+ */
+int qdsa_verify_h128(
+   const uint8_t sig[64], const uint8_t pk[32], const uint8_t msg[32])
+{
+   return verify(sig, pk, msg, 128);
+}
+#endif
+
+#if CONF_QDSA_XPK
+/*
+ * Expanded public key, 144B/36W. The wrapped point shares its (unused) X with
+ * Q.T, so &Q.T can be passed to the Ladder as a kpoint.
+ */
+typedef struct {
+   ckpoint pk;
+   kpoint Q;
+   fe1271 W[3];
+} _align4 xpkey;
+
+/* -----------------------------------------------------------------------------
+ * Expand a public key for repeated verification: decompress and wrap it once.
+ * The result is deterministic and may be generated offline and put in Flash.
+ * [h]Q remains the variable-base Ladder on the wrapped point.
+ *
+ * Input:
+ *      pk (32 bytes): Public key
+ * Output:
+ *      xpk (144 bytes): Expanded public key
+ *      0 if the key decompresses, 1 otherwise
+ */
+int qdsa_pk_expand(uint8_t xpk[144], const uint8_t pk[32])
+{
+   xpkey *x = (xpkey *)xpk;
+   kpoint t;
+
+   if (decompress(&x->Q, &t, (const ckpoint *)pk)) {
       return 1;
    }
+   xWRAP(&t, &x->Q);
+   wam_copy(&x->pk, pk, 32);
+   wam_copy(x->W, &t.Y, 3 * sizeof(fe1271));
+   return 0;
+}
 
-   scalar_get32(R.X.v, sig + 32);        // 2nd half sig: s in R.X, R.Y.
-   scalar_get_hrqm(&R.Z, sig, pk, msg);  // h = H(R||Q||M) in R.Z, R.T.
+static int verify_xpk(const uint8_t *sig, const uint8_t *xpk,
+   const jpoint *tab, const uint8_t *msg)
+{
+   const xpkey *x = (const xpkey *)xpk;
+   kpoint sP, hQ, t;
 
-   xWRAP(&pxw, &sP);
-   ladder_250(&hQ, &sP, &pxw, R.Z.b);  // [h]Q
-   ladder_base_250(&sP, R.X.b);        // [s]P
-   return check(&sP, &hQ, &R, &pxw, (ckpoint *)sig);
+   PROF_START();
+   wam_copy(&sP, &x->Q, sizeof(kpoint));
+   return verify_tail(sig, x->pk.b, msg, &sP, &hQ, (const kpoint *)&x->Q.T,
+      tab, &t, 251, NULL);
 }
 
-#if CONF_QDSA_FULL
+/* -----------------------------------------------------------------------------
+ * Same as qdsa_verify() but with an expanded public key, which skips the
+ * square root in decompress and the inversion in xWRAP.
+ */
+int qdsa_verify_xpk(
+   const uint8_t sig[64], const uint8_t xpk[144], const uint8_t msg[32])
+{
+   return verify_xpk(sig, xpk, NULL, msg);
+}
 
-static void large_neg(uint32_t *r, const uint32_t *x)
+#if CONF_QDSA_XTAB
+/* -----------------------------------------------------------------------------
+ * Build the fixed-base table of an expanded key: [k 16^i]D for k = 1..8 and
+ * i < 63, where D on the Jacobian is a lift of Q (either one; D and -D have
+ * the same Kummer points). Costs about ten verifies; like the expanded key,
+ * the table may be generated offline and put in Flash.
+ *
+ * Input:
+ *      xpk (144 bytes): Expanded public key
+ * Output:
+ *      tab (QDSA_XTAB_LEN bytes): Table
+ *      0 on success; 1 if Q does not lift to the Jacobian (a point of the
+ *      twist) or a special divisor came up, then use qdsa_verify_xpk()
+ */
+int qdsa_pk_table(uint8_t tab[QDSA_XTAB_LEN], const uint8_t xpk[144])
 {
-   static const uint32_t N[8] = { 0x7BF3FA43, 0xB88CF4B4, 0x65EAB00, 0x2D3D8036,
-      0xDF38AD6B, 0xFCCB2967, 0xFFFFFFFF, 0x3FFFFFF };
-   uint64_t t0, t1;
-   uint32_t carry = 0;
-   for (int i = 0; i < 8; i++) {
-      t0 = (uint64_t)N[i];
-      t1 = (uint64_t)x[i];
-      t1 += carry;
-      t0 -= t1;
-      carry = (t0 >> 32) & 1;
-      r[i] = (uint32_t)t0;
+   const xpkey *x = (const xpkey *)xpk;
+   jpoint *T = (jpoint *)tab;
+   jpointz p, z[6];
+   fe1271 xi[4], dd, a, b, t, u;
+   int i, k;
+
+   // xi = jMi Q, scaled to xi_1 = 1: u1 = -xi_2, u0 = xi_3.
+   jmat(xi, jMi, (const fe1271 *)&x->Q);
+   if (fe1271_zeroness(&xi[0]) == 0) {
+      return 1;
+   }
+   fe1271_invert(&t, &xi[0]);
+   fe1271_mulred(&T->u1, &xi[1], &t);
+   fe1271_neg(&T->u1);
+   fe1271_mulred(&T->u0, &xi[2], &t);
+   fe1271_mulred(&xi[3], &xi[3], &t);
+
+   // f mod u = a x + b, Horner from f5 = 1 down to f0 = 0.
+   fe1271_setzero(&a);
+   set_const(&b, 1);
+   for (k = 3; k >= -1; k--) {
+      fe1271_mulred(&t, &a, &T->u1);
+      fe1271_mulred(&u, &a, &T->u0);
+      fe1271_sub(&a, &b, &t);
+      fe1271_setzero(&b);
+      fe1271_sub(&b, k >= 0 ? &jf[k] : &b, &u);
+   }
+
+   // xi_4 = F0 - 2 y1 y2 fixes v: v1^2 = (xi_4 dd - F0 + 2b - u1 a)/dd,
+   // dd = u1^2 - 4 u0, and v0 = (a + u1 v1^2)/2v1.
+   set_const(&u, 1);
+   jf0(&t, &T->u1, &T->u0, &u);
+   fe1271_add(&u, &T->u0, &T->u0);
+   fe1271_add(&u, &u, &u);
+   fe1271_sqrred(&dd, &T->u1);
+   fe1271_sub(&dd, &dd, &u);
+   if (fe1271_zeroness(&dd) == 0) {
+      return 1;
+   }
+   fe1271_mulred(&u, &xi[3], &dd);
+   fe1271_sub(&u, &u, &t);
+   fe1271_add(&u, &u, &b);
+   fe1271_add(&u, &u, &b);
+   fe1271_mulred(&t, &T->u1, &a);
+   fe1271_sub(&u, &u, &t);
+   fe1271_invert(&t, &dd);
+   fe1271_mulred(&u, &u, &t);
+   if (fe1271_has_sqrt(&T->v1, &t, &u, 0) || fe1271_zeroness(&T->v1) == 0) {
+      return 1;
+   }
+   fe1271_mulred(&t, &T->u1, &u);
+   fe1271_add(&t, &t, &a);
+   fe1271_add(&u, &T->v1, &T->v1);
+   fe1271_invert(&dd, &u);
+   fe1271_mulred(&T->v0, &t, &dd);
+
+   for (i = 0; i < XTAB_ROWS; i++, T += 8) {
+      if (i > 0 && jdbl(T, T - 1)) {  // 16^i = 2 * 8 * 16^(i-1)
+         return 1;
+      }
+      if (jdbl(T + 1, T)) {
+         return 1;
+      }
+      jset(&p, T + 1);
+      for (k = 0; k < 6; k++) {
+         if (jadd(&p, T, 0)) {
+            return 1;
+         }
+         wam_copy(&z[k], &p, sizeof(jpointz));
+      }
+      jnorm(T + 2, z, 6);
+   }
+   return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Same as qdsa_verify_xpk() with the table of the key: [h]Q is the comb, about
+ * 60 Jacobian additions, instead of the Ladder.
+ */
+int qdsa_verify_xtab(const uint8_t sig[64], const uint8_t xpk[144],
+   const uint8_t tab[QDSA_XTAB_LEN], const uint8_t msg[32])
+{
+   return verify_xpk(sig, xpk, (const jpoint *)tab, msg);
+}
+#endif
+#endif  // CONF_QDSA_XPK
+
+#if CONF_QDSA_BUNDLE
+/* -----------------------------------------------------------------------------
+ * Bundle verification. Workers poll b->fail before each item and between the
+ * two Ladders, so a failure elsewhere costs each of them at most one Ladder.
+ * b->fail keeps the lowest failing index seen plus one; it is updated with a
+ * compare-and-swap where the target has one (M0 has none, nor a second core).
+ */
+void qdsa_bundle_init(qdsa_bundle *b)
+{
+   b->fail = 0;
+}
+
+static void bundle_fail(qdsa_bundle *b, uint32_t i)
+{
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+   uint32_t f = __atomic_load_n(&b->fail, __ATOMIC_RELAXED);
+   while ((f == 0 || i + 1 < f)
+      && !__atomic_compare_exchange_n(
+         &b->fail, &f, i + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+#else
+   if (b->fail == 0 || i + 1 < b->fail) b->fail = i + 1;
+#endif
+}
+
+/*
+ * Verify items from..to-1. Consecutive items with the same key share one
+ * decompress and xWRAP, as bundles are usually signed by one key.
+ * Return 0 if they all passed and no other worker failed, 1 otherwise.
+ */
+int qdsa_verify_bundle(qdsa_bundle *b, const uint8_t sig[][64],
+   const uint8_t pk[][32], const uint8_t msg[][32], size_t from, size_t to)
+{
+   kpoint Q, Qw, sP, hQ, t;
+   const uint32_t *key = NULL;
+
+   for (size_t i = from; i < to; i++) {
+      const uint32_t *k = (const uint32_t *)pk[i];
+      int same = key != NULL;
+
+      if (b->fail) return 1;
+      PROF_START();
+      for (int j = 0; j < 8 && same; j++)
+         same = k[j] == key[j];
+      if (!same) {
+         key = NULL;
+         if (decompress(&Q, &t, (const ckpoint *)k)) {
+            bundle_fail(b, i);
+            return 1;
+         }
+         PROF_MARK(DECOMPRESS);
+         xWRAP(&Qw, &Q);
+         PROF_MARK(WRAP);
+         key = k;
+      }
+      wam_copy(&sP, &Q, sizeof(kpoint));
+      int res =
+         verify_tail(
+            sig[i], pk[i], msg[i], &sP, &hQ, &Qw, NULL, &t, 251, &b->fail);
+      if (res > 0) bundle_fail(b, i);
+      if (res) return 1;
+   }
+   return b->fail != 0;
+}
+#endif  // CONF_QDSA_BUNDLE
+
+#if CONF_QDSA_SCHED
+/* -----------------------------------------------------------------------------
+ * Two-class scheduler. Each class is a ring with one producer and any number
+ * of consumers: submit fills a slot and then moves tail, a worker reads a run
+ * of slots and then claims them by moving head with a compare-and-swap, so a
+ * slot is not reused before it has been read.
+ */
+#include <time.h>
+
+static uint64_t sched_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void qdsa_sched_init(qdsa_sched *s, qdsa_req **ring, unsigned cap,
+   unsigned batch, unsigned reserved)
+{
+   s->ring[QDSA_LAT] = ring;
+   s->ring[QDSA_BULK] = ring + cap;
+   s->mask = cap - 1;
+   s->batch = batch < 1 ? 1 : batch > QDSA_SCHED_MAX ? QDSA_SCHED_MAX : batch;
+   s->reserved = reserved;
+   s->head[0] = s->head[1] = s->tail[0] = s->tail[1] = 0;
+}
+
+int qdsa_sched_submit(qdsa_sched *s, qdsa_req *r)
+{
+   int c = r->cls;
+   uint32_t t = s->tail[c];
+
+   if (t - __atomic_load_n(&s->head[c], __ATOMIC_ACQUIRE) > s->mask) return 1;
+   if (!r->t_in) r->t_in = sched_ns();
+   r->res = -1;
+   s->ring[c][t & s->mask] = r;
+   __atomic_store_n(&s->tail[c], t + 1, __ATOMIC_RELEASE);
+   return 0;
+}
+
+/* Claim up to max waiting requests of class c into b; returns how many. */
+static unsigned sched_claim(qdsa_sched *s, int c, unsigned max, qdsa_req **b)
+{
+   uint32_t h = __atomic_load_n(&s->head[c], __ATOMIC_RELAXED);
+
+   for (;;) {
+      uint32_t n = __atomic_load_n(&s->tail[c], __ATOMIC_ACQUIRE) - h;
+      if (n > max) n = max;
+      if (n == 0) return 0;
+      for (uint32_t i = 0; i < n; i++)
+         b[i] = s->ring[c][(h + i) & s->mask];
+      if (__atomic_compare_exchange_n(&s->head[c], &h, h + n, 0,
+             __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+         return n;
+   }
+}
+
+static void sched_done(qdsa_req *r, int res)
+{
+   r->t_done = sched_ns();
+   __atomic_store_n(&r->res, res, __ATOMIC_RELEASE);
+}
+
+static int sched_keycmp(const uint8_t *a, const uint8_t *b)
+{
+   int i = 0;
+
+   while (i < 31 && a[i] == b[i])
+      i++;
+   return a[i] - b[i];
+}
+
+/*
+ * Bulk batch: sorted by key, so that each key is decompressed and wrapped
+ * once for all its requests, as in qdsa_verify_bundle.
+ */
+static void sched_bulk(qdsa_req **b, unsigned n)
+{
+   kpoint Q, Qw, sP, hQ, t;
+   int bad = 0;
+
+   for (unsigned i = 1; i < n; i++) {
+      qdsa_req *v = b[i];
+      unsigned j = i;
+      for (; j > 0 && sched_keycmp(b[j - 1]->pk, v->pk) > 0; j--)
+         b[j] = b[j - 1];
+      b[j] = v;
+   }
+   for (unsigned i = 0; i < n; i++) {
+      qdsa_req *r = b[i];
+      int res = 1;
+
+      PROF_START();
+      if (i == 0 || sched_keycmp(b[i - 1]->pk, r->pk)) {
+         bad = decompress(&Q, &t, (const ckpoint *)r->pk);
+         PROF_MARK(DECOMPRESS);
+         if (!bad) xWRAP(&Qw, &Q);
+         PROF_MARK(WRAP);
+      }
+      if (!bad) {
+         wam_copy(&sP, &Q, sizeof(kpoint));
+         res = verify_tail(
+            r->sig, r->pk, r->msg, &sP, &hQ, &Qw, NULL, &t, 251, NULL);
+      }
+      sched_done(r, res);
    }
 }
 
+/* -----------------------------------------------------------------------------
+ * Serve one latency request, or else (if worker w is not reserved) one bulk
+ * batch. Returns the number of requests served, 0 if none was waiting.
+ */
+unsigned qdsa_sched_work(qdsa_sched *s, unsigned w)
+{
+   qdsa_req *b[QDSA_SCHED_MAX];
+   unsigned n = sched_claim(s, QDSA_LAT, 1, b);
+
+   if (!n && w >= s->reserved) n = sched_claim(s, QDSA_BULK, s->batch, b);
+   if (!n) return 0;
+   uint64_t t = sched_ns();
+   for (unsigned i = 0; i < n; i++)
+      b[i]->t_start = t;
+   if (b[0]->cls == QDSA_LAT)
+      sched_done(b[0], qdsa_verify(b[0]->sig, b[0]->pk, b[0]->msg));
+   else
+      sched_bulk(b, n);
+   return n;
+}
+#endif  // CONF_QDSA_SCHED
+
+#if CONF_QDSA_STREAM
+/* -----------------------------------------------------------------------------
+ * Streaming verify: copy an image block by block from src to dst while hashing
+ * it, then verify the signature on the hash. qdsa_stream has the layout of
+ * bobjr_ctx.
+ */
+typedef char qdsa_stream_is_bobjr_ctx[
+   sizeof(qdsa_stream) == sizeof(bobjr_ctx) ? 1 : -1];
+
+void qdsa_stream_init(qdsa_stream *s)
+{
+   bobjr_init((bobjr_ctx *)s);
+}
+
+void qdsa_stream_copy(qdsa_stream *s, void *dst, const void *src, size_t len)
+{
+   bobjr_absorb_copy((bobjr_ctx *)s, dst, src, len);
+}
+
+int qdsa_stream_verify(
+   qdsa_stream *s, const uint8_t sig[64], const uint8_t pk[32])
+{
+   bobjr_finish_wa((bobjr_ctx *)s);  // H(image) in state.
+   return qdsa_verify(sig, pk, (const uint8_t *)s->state);
+}
+#endif
+
+#if CONF_QDSA_DIGEST
+/* -----------------------------------------------------------------------------
+ * Image digest to the 32-byte message of sign/verify.
+ * Input:
+ *      img, len: the image, any alignment
+ *      ver: digest version, QDSA_DIGEST_*
+ * Output:
+ *      md (32 bytes): message digest
+ *      return 0, or -1 for unknown version
+ *
+ * v1 is plain TurboSHAKE128(img, D=0x1f) to 256 bits, so any implementation
+ * of it can reproduce the message.
+ */
+int qdsa_digest(uint8_t md[32], const uint8_t *img, size_t len, int ver)
+{
+   ts128_ctx ctx;
+
+   if (ver != QDSA_DIGEST_TS128) return -1;
+   ts128_init(&ctx);
+   ts128_absorb(&ctx, img, len);
+   ts128_finish(&ctx, 0x1f);
+   ts128_squeeze(&ctx, md, 32);
+   return 0;
+}
+#endif
+
+#if CONF_QDSA_FULL
+
 static void scalar_ops(
    uint32_t *s, const ckpoint *r, const uint32_t *h, const uint32_t *d)
 {
-   uint32_t t[16];
+   uint32_t t[8];
 
-   large_mul(t, h, d);
-   large_red(s, t);
-   wam_zero(&t[8], 8 * 4);
-   large_neg(t, s);
-   large_add(t, r->fe1.v, 0);
-   large_red(s, t);
+   scalar_mul(t, h, d);
+   scalar_sub(s, r->fe1.v, t);
 }
 
 static void T_row(fe1271 *r, const fe1271 *X1, const fe1271 *X2,
@@ -1176,13 +2525,13 @@ static void compress(fe1271 *l1, fe1271 *l2, const kpoint *x)
    }
 
    // Normalize
-   fe1271_mul(&t.T, &t.T, l2);
-   fe1271_mul(l1, &t.X, l2);
-   fe1271_mul(l2, &t.Y, l2);
+   fe1271_mulred(&t.T, &t.T, l2);
+   fe1271_mulred(l1, &t.X, l2);
+   fe1271_mulred(l2, &t.Y, l2);
 
    // k2*l4 - k3
    get_k2(&t.Z, &t.X, l1, l2, tau);
-   fe1271_mul(&t.Z, &t.Z, &t.T);
+   fe1271_mulred(&t.Z, &t.Z, &t.T);
    get_k3(&t.T, &t.X, &t.Y, l1, l2, tau);
    fe1271_sub(&t.Z, &t.Z, &t.T);
 
@@ -1206,9 +2555,13 @@ int qdsa_dh_keygen(uint8_t pk[32], const uint8_t sk[32])
    kpoint R;
    ckpoint rx;  // group scalar
 
+   PROF_START();
    scalar_get32(rx.fe1.v, sk);
+   PROF_MARK(SCALAR);
    ladder_base_250(&R, rx.fe1.b);
+   PROF_MARK(LADDER_BASE);
    compress(&rx.fe1, &rx.fe2, &R);
+   PROF_MARK(COMPRESS);
    wam_copy(pk, &rx, 32);
    return 0;
 }
@@ -1221,23 +2574,102 @@ int qdsa_dh_keygen(uint8_t pk[32], const uint8_t sk[32])
  *      pk (32 bytes): Public key (remote)
  * Output:
  *      ss (32 bytes): Shared secret
+ *
+ * Returns 1 without a secret if pk does not decompress, 0 otherwise.
  */
 int qdsa_dh_exchange(uint8_t ss[32], const uint8_t pk[32], const uint8_t sk[32])
 {
    kpoint SS, PK, pkw;
    ckpoint pkc;
 
+   PROF_START();
    wam_copy(&pkc, pk, 32);
-   decompress(&PK, &SS, &pkc);
+   if (decompress(&PK, &SS, &pkc)) {
+      return 1;
+   }
+   PROF_MARK(DECOMPRESS);
    xWRAP(&pkw, &PK);
+   PROF_MARK(WRAP);
 
    scalar_get32(pkc.fe1.v, sk);
-   ladder_250(&SS, &PK, &pkw, pkc.fe1.b);
+   PROF_MARK(SCALAR);
+   ladder(&SS, &PK, &pkw, pkc.fe1.b, 251);
+   PROF_MARK(LADDER);
    compress(&pkc.fe1, &pkc.fe2, &SS);
+   PROF_MARK(COMPRESS);
    wam_copy(ss, &pkc, 32);
    return 0;
 }
 
+#if CONF_QDSA_DHC
+/* -----------------------------------------------------------------------------
+ * Shared-secret cache for repeated peers. Entries are keyed by (peer pk, kid),
+ * evicted least recently used, and zeroed on eviction and invalidation.
+ */
+void qdsa_dh_cache_init(qdsa_dh_cache *c, qdsa_dh_entry *e, unsigned n)
+{
+   wam_zero(e, n * sizeof(qdsa_dh_entry));
+   c->e = e;
+   c->n = n;
+   c->tick = c->hits = c->misses = 0;
+}
+
+static int dhc_match(const qdsa_dh_entry *e, const uint32_t *pk, uint32_t kid)
+{
+   uint32_t d = e->kid ^ kid;
+
+   for (int i = 0; i < 8; i++)
+      d |= e->pk[i] ^ pk[i];
+   return e->used && !d;
+}
+
+int qdsa_dh_exchange_cached(qdsa_dh_cache *c, uint8_t ss[32],
+   const uint8_t pk[32], const uint8_t sk[32], uint32_t kid)
+{
+   qdsa_dh_entry *e = c->e, *v = c->e;
+
+   if (++c->tick == 0) {  // after 2^32 calls: forget the order
+      for (uint i = 0; i < c->n; i++)
+         if (e[i].used) e[i].used = 1;
+      c->tick = 2;
+   }
+   for (uint i = 0; i < c->n; i++) {
+      if (dhc_match(&e[i], (const uint32_t *)pk, kid)) {
+         e[i].used = c->tick;
+         wam_copy(ss, e[i].ss, 32);
+         c->hits++;
+         return 0;
+      }
+      if (e[i].used < v->used) v = &e[i];
+   }
+   c->misses++;
+   int ret = qdsa_dh_exchange(ss, pk, sk);
+   if (ret || c->n == 0) return ret;
+   wam_zero(v, sizeof(qdsa_dh_entry));
+   wam_copy(v->pk, pk, 32);
+   wam_copy(v->ss, ss, 32);
+   v->kid = kid;
+   v->used = c->tick;
+   return ret;
+}
+
+/* Drop (pk, kid); pk NULL drops all entries of kid. */
+void qdsa_dh_cache_drop(qdsa_dh_cache *c, const uint8_t pk[32], uint32_t kid)
+{
+   for (uint i = 0; i < c->n; i++) {
+      qdsa_dh_entry *e = &c->e[i];
+      if (e->used && e->kid == kid
+         && (!pk || dhc_match(e, (const uint32_t *)pk, kid)))
+         wam_zero(e, sizeof(qdsa_dh_entry));
+   }
+}
+
+void qdsa_dh_cache_clear(qdsa_dh_cache *c)
+{
+   wam_zero(c->e, c->n * sizeof(qdsa_dh_entry));
+}
+#endif  // CONF_QDSA_DHC
+
 /* -----------------------------------------------------------------------------
  * Generate a 64-byte pseudo-random string (sk), and a compressed public key
  * point (pk) on the Kummer.
@@ -1254,14 +2686,18 @@ int qdsa_keypair(uint8_t pk[32], uint8_t sk[64], const uint8_t seed[32])
    ckpoint rx;
    bobjr_ctx ctx;
 
+   PROF_START();
    bobjr_init(&ctx);
    bobjr_absorb_wa(&ctx, seed, 32);  // d
    bobjr_finish_wa(&ctx);            // H(d)
    wam_copy(sk, ctx.state, 64);      // d", d' is sk.
 
    scalar_get32(rx.fe1.v, sk + 32);
+   PROF_MARK(SCALAR);
    ladder_base_250(&R, rx.fe1.b);
+   PROF_MARK(LADDER_BASE);
    compress(&rx.fe1, &rx.fe2, &R);
+   PROF_MARK(COMPRESS);
    wam_copy(pk, &rx, 32);  // Q = compressed [d']P is pk.
    return 0;
 }
@@ -1274,33 +2710,697 @@ int qdsa_keypair(uint8_t pk[32], uint8_t sk[64], const uint8_t seed[32])
  *      msg (32 bytes): Message
  *      pk (32 bytes): Public key
  *      sk (64 bytes): Pseudo-random secret
+ *      hb: Challenge bit-length, 251; or 128 for H128
  * Output:
  *      sig (64 bytes): signature
  */
-int qdsa_sign(uint8_t sig[64], const uint8_t msg[32], const uint8_t pk[32],
-   const uint8_t sk[64])
+static int sign(uint8_t *sig, const uint8_t *msg, const uint8_t *pk,
+   const uint8_t *sk, int hb)
 {
    kpoint R;
    ckpoint rx, r;
    bobjr_ctx ctx;
 
+   PROF_START();
    bobjr_init(&ctx);
    bobjr_absorb_wa(&ctx, sk, 32);   // d" in 1st half of secret key.
    bobjr_absorb_wa(&ctx, msg, 32);  // M
    bobjr_finish_wa(&ctx);           // r = H(d"||M) ready in state.
-   large_red(r.fe1.v, (uint32_t *)ctx.state);
+   scalar_red(r.fe1.v, (uint32_t *)ctx.state);
+   PROF_MARK(SCALAR);
 
    ladder_base_250(&R, r.fe1.b);
+   PROF_MARK(LADDER_BASE);
    compress(&rx.fe1, &rx.fe2, &R);
+   PROF_MARK(COMPRESS);
    wam_copy(sig, &rx, 32);  // 1st half of sig: R = compressed [r]P
 
-   scalar_get_hrqm(&R.X, rx.b, pk, msg);  // h = H(R||Q||M) in R.X, R.Y.
-   scalar_get32(R.Z.v, sk + 32);          // d' in 2nd half of secret key.
-   scalar_ops(R.Z.v, &r, R.X.v, R.Z.v);   // s = (r-hd') mod N.
-   wam_copy(sig + 32, &R.Z, 32);          // 2nd half of sig: s in R.Z, R.T.
+#if CONF_QDSA_H128
+   if (hb == 128)
+      scalar_get_h128(&R.X, rx.b, pk, msg);
+   else
+#endif
+      scalar_get_hrqm(&R.X, rx.b, pk, msg);  // h = H(R||Q||M) in R.X, R.Y.
+   scalar_get32(R.Z.v, sk + 32);         // d' in 2nd half of secret key.
+   scalar_ops(R.Z.v, &r, R.X.v, R.Z.v);  // s = (r-hd') mod N.
+   wam_copy(sig + 32, &R.Z, 32);         // 2nd half of sig: s in R.Z, R.T.
+   PROF_MARK(SCALAR);
+   return 0;
+}
+
+int qdsa_sign(uint8_t sig[64], const uint8_t msg[32], const uint8_t pk[32],
+   const uint8_t sk[64])
+{
+   return sign(sig, msg, pk, sk, 251);
+}
+
+#if CONF_QDSA_H128
+/* -----------------------------------------------------------------------------
+ * Generate an H128 signature; see CONF_QDSA_H128. Same interface as above.
+ */
+int qdsa_sign_h128(uint8_t sig[64], const uint8_t msg[32],
+   const uint8_t pk[32], const uint8_t sk[64])
+{
+   return sign(sig, msg, pk, sk, 128);
+}
+#endif
+
+/*
+ * Crossover points of the batch calls. Without tuning every chunk goes to the
+ * lanes, and hashes are single: the two-way sponge pays only on some hosts.
+ */
+#if CONF_QDSA_TUNE
+static qdsa_tune tune = { .lanes_base = 1, .lanes_dh = 1, .x2 = 0 };
+#define TUNED(f, d) (tune.f)
+#else
+#define TUNED(f, d) (d)
+#endif
+
+#if CONF_QDSA_LANES
+
+/*
+ * Batch tail shared by keygen and DH: NL scalars in, NL compressed points out.
+ * Lanes beyond n are computed on lane 0's input and discarded.
+ */
+static void batch_compress(uint8_t (*out)[32], const kpointx *xp, uint n)
+{
+   kpoint R;
+   ckpoint rx;
+
+   for (uint l = 0; l < n; l++) {
+      kpx_get(&R, xp, l);
+      compress(&rx.fe1, &rx.fe2, &R);
+      wam_copy(out[l], &rx, 32);
+   }
+}
+
+static void batch_scalars(uint8_t (*s)[32], const uint8_t (*sk)[32],
+   uint stride, uint n)
+{
+   for (uint l = 0; l < NL; l++) {
+      const uint8_t *k = (const uint8_t *)sk + (l < n ? l : 0) * stride;
+      scalar_get32((uint32_t *)s[l], k);
+   }
+}
+
+/* h = H(R||Q||M) for n signatures; pairs share the two-way sponge. */
+static void batch_hrqm(uint32_t (*h)[8], const uint8_t (*sig)[64],
+   const uint8_t (*pk)[32], const uint8_t (*msg)[32], uint n)
+{
+   uint l = 0;
+#if CONF_BOBJR_X2
+   bobjr_ctx2 c2;
+   bobjr_ctx c0, c1;
+
+   for (; l + 1 < n && TUNED(x2, 0); l += 2) {
+      bobjr_init2(&c2);
+      bobjr_absorb2_wa(&c2, sig[l], sig[l + 1], 32);
+      bobjr_absorb2_wa(&c2, pk[l], pk[l + 1], 32);
+      bobjr_absorb2_wa(&c2, msg[l], msg[l + 1], 32);
+      bobjr_finish2_wa(&c2, &c0, &c1);
+      scalar_red(h[l], (uint32_t *)c0.state);
+      scalar_red(h[l + 1], (uint32_t *)c1.state);
+   }
+#endif
+   for (; l < n; l++)
+      scalar_get_hrqm((fe1271 *)h[l], sig[l], pk[l], msg[l]);
+}
+
+/* One chunk of m <= NL keygen or DH calls on the lanes. */
+static void keygen_lanes(uint8_t (*pk)[32], const uint8_t (*sk)[32], uint m)
+{
+   kpointx xp, xq, xd;
+   uint8_t _align4 s[NL][32];
+
+   batch_scalars(s, sk, 32, m);
+   ladder_base_250x(&xp, &xq, &xd, s);
+   batch_compress(pk, &xp, m);
+   wam_zero(s, sizeof(s));
+}
+
+static int dh_lanes(uint8_t (*ss)[32], const uint8_t (*pk)[32],
+   const uint8_t (*sk)[32], uint m)
+{
+   kpointx xp, xq, xd;
+   kpoint PK, t;
+   ckpoint pkc;
+   uint8_t _align4 s[NL][32];
+   int ret = 0;
+
+   for (uint l = 0; l < NL; l++) {
+      wam_copy(&pkc, pk[l < m ? l : 0], 32);
+      ret |= decompress(&PK, &t, &pkc);
+      xWRAP(&t, &PK);
+      kpx_set(&xq, l, &PK);
+      kpx_set(&xd, l, &t);
+   }
+   batch_scalars(s, sk, 32, m);
+   ladder_250x(&xp, &xq, &xd, s);
+   batch_compress(ss, &xp, m);
+   wam_zero(s, sizeof(s));
+   return ret;
+}
+
+/* -----------------------------------------------------------------------------
+ * Batch versions of the signing, keygen and DH calls. Each runs its Ladders
+ * CONF_QDSA_LANES at a time; outputs are identical to the single calls.
+ */
+int qdsa_dh_keygen_batch(uint8_t pk[][32], const uint8_t sk[][32], uint n)
+{
+   for (uint i = 0; i < n; i += NL) {
+      uint m = n - i < NL ? n - i : NL;
+      if (m < TUNED(lanes_base, 1)) {
+         for (uint l = 0; l < m; l++)
+            qdsa_dh_keygen(pk[i + l], sk[i + l]);
+         continue;
+      }
+      keygen_lanes(pk + i, sk + i, m);
+   }
+   return 0;
+}
+
+int qdsa_dh_exchange_batch(
+   uint8_t ss[][32], const uint8_t pk[][32], const uint8_t sk[][32], uint n)
+{
+   int ret = 0;
+
+   for (uint i = 0; i < n; i += NL) {
+      uint m = n - i < NL ? n - i : NL;
+      if (m < TUNED(lanes_dh, 1)) {
+         for (uint l = 0; l < m; l++)
+            ret |= qdsa_dh_exchange(ss[i + l], pk[i + l], sk[i + l]);
+         continue;
+      }
+      ret |= dh_lanes(ss + i, pk + i, sk + i, m);
+   }
+   return ret;
+}
+
+int qdsa_keypair_batch(
+   uint8_t pk[][32], uint8_t sk[][64], const uint8_t seed[][32], uint n)
+{
+   kpointx xp, xq, xd;
+   uint8_t _align4 s[NL][32];
+   bobjr_ctx ctx;
+
+   uint i = 0;
+#if CONF_BOBJR_X2
+   bobjr_ctx2 c2;
+   bobjr_ctx cty;
+
+   for (; i + 1 < n && TUNED(x2, 0); i += 2) {
+      bobjr_init2(&c2);
+      bobjr_absorb2_wa(&c2, seed[i], seed[i + 1], 32);
+      bobjr_finish2_wa(&c2, &ctx, &cty);
+      wam_copy(sk[i], ctx.state, 64);
+      wam_copy(sk[i + 1], cty.state, 64);
+   }
+   wam_zero(&c2, sizeof(c2));
+   wam_zero(&cty, sizeof(cty));
+#endif
+   for (; i < n; i++) {
+      bobjr_init(&ctx);
+      bobjr_absorb_wa(&ctx, seed[i], 32);  // d
+      bobjr_finish_wa(&ctx);               // H(d)
+      wam_copy(sk[i], ctx.state, 64);      // d", d' is sk.
+   }
+   wam_zero(&ctx, sizeof(ctx));
+
+   for (i = 0; i < n; i += NL) {
+      uint m = n - i < NL ? n - i : NL;
+      if (m < TUNED(lanes_base, 1)) {
+         for (uint l = 0; l < m; l++)
+            qdsa_dh_keygen(pk[i + l], sk[i + l] + 32);  // same Ladder on d'
+         continue;
+      }
+      batch_scalars(s, (const uint8_t (*)[32])(sk[i] + 32), 64, m);
+      ladder_base_250x(&xp, &xq, &xd, s);
+      batch_compress(pk + i, &xp, m);  // Q = compressed [d']P is pk.
+   }
+   wam_zero(s, sizeof(s));
+   return 0;
+}
+
+int qdsa_sign_batch(uint8_t sig[][64], const uint8_t msg[][32],
+   const uint8_t pk[][32], const uint8_t sk[][64], uint n)
+{
+   kpointx xp, xq, xd;
+   kpoint R;
+   ckpoint rx;
+   uint32_t h[NL][8];
+   uint8_t _align4 r[NL][32];
+   bobjr_ctx ctx;
+#if CONF_BOBJR_X2
+   bobjr_ctx2 c2;
+   bobjr_ctx cty;
+#endif
+
+   for (uint i = 0; i < n; i += NL) {
+      uint m = n - i < NL ? n - i : NL;
+      uint l = 0;
+      if (m < TUNED(lanes_base, 1)) {
+         for (; l < m; l++)
+            qdsa_sign(sig[i + l], msg[i + l], pk[i + l], sk[i + l]);
+         continue;
+      }
+#if CONF_BOBJR_X2
+      for (; l + 1 < NL && TUNED(x2, 0); l += 2) {
+         uint k0 = i + (l < m ? l : 0);
+         uint k1 = i + (l + 1 < m ? l + 1 : 0);
+         bobjr_init2(&c2);
+         bobjr_absorb2_wa(&c2, sk[k0], sk[k1], 32);
+         bobjr_absorb2_wa(&c2, msg[k0], msg[k1], 32);
+         bobjr_finish2_wa(&c2, &ctx, &cty);
+         scalar_red((uint32_t *)r[l], (uint32_t *)ctx.state);
+         scalar_red((uint32_t *)r[l + 1], (uint32_t *)cty.state);
+      }
+#endif
+      for (; l < NL; l++) {
+         uint k = i + (l < m ? l : 0);
+         bobjr_init(&ctx);
+         bobjr_absorb_wa(&ctx, sk[k], 32);   // d" in 1st half of secret key.
+         bobjr_absorb_wa(&ctx, msg[k], 32);  // M
+         bobjr_finish_wa(&ctx);              // r = H(d"||M) ready in state.
+         scalar_red((uint32_t *)r[l], (uint32_t *)ctx.state);
+      }
+      ladder_base_250x(&xp, &xq, &xd, r);
+      for (l = 0; l < m; l++) {
+         kpx_get(&R, &xp, l);
+         compress(&rx.fe1, &rx.fe2, &R);
+         wam_copy(sig[i + l], &rx, 32);  // 1st half of sig: R = [r]P
+      }
+      batch_hrqm(h, sig + i, pk + i, msg + i, m);  // h = H(R||Q||M)
+      for (l = 0; l < m; l++) {
+         uint k = i + l;
+         wam_copy(&rx, r[l], 32);
+         scalar_get32(R.Z.v, sk[k] + 32);  // d' in 2nd half of secret key.
+         scalar_ops(R.Z.v, &rx, h[l], R.Z.v);  // s = (r-hd') mod N.
+         wam_copy(sig[k] + 32, &R.Z, 32);
+      }
+   }
+   wam_zero(r, sizeof(r));
+   wam_zero(&ctx, sizeof(ctx));
+#if CONF_BOBJR_X2
+   wam_zero(&c2, sizeof(c2));
+   wam_zero(&cty, sizeof(cty));
+#endif
    return 0;
 }
+#endif  // CONF_QDSA_LANES
 
 #endif  // CONF_QDSA_FULL
 
+#if CONF_QDSA_LOG
+/* -----------------------------------------------------------------------------
+ * Signed log. The head is a Bob Jr chain over the records,
+ *      head_0   = H("qLI1" || id)
+ *      head_i+1 = H("qLR1" || head_i || i || len_i || rec_i || 0-pad to word)
+ * and a checkpoint is a regular signature on H("qLC1" || n || head_n), so one
+ * verify covers all records from any saved state of the log to the
+ * checkpoint. Integers are 32-bit little-endian.
+ */
+static void log_start(bobjr_ctx *ctx, char t)
+{
+   uint8_t _align4 tag[4] = { 'q', 'L', t, '1' };
+
+   bobjr_init(ctx);
+   bobjr_absorb_wa(ctx, tag, 4);
+}
+
+/* Whole words, then the tail zero-padded to a word. */
+static void log_absorb(bobjr_ctx *ctx, const uint8_t *data, size_t len)
+{
+   uint32_t tail = 0;
+
+   bobjr_absorb_wa(ctx, data, len & ~3);
+   for (uint i = 0; i < (len & 3); i++)
+      tail |= (uint32_t)data[(len & ~3) + i] << (8 * i);
+   if (len & 3) bobjr_absorb_wa(ctx, (const uint8_t *)&tail, 4);
+}
+
+static void log_finish(bobjr_ctx *ctx, uint32_t *out)
+{
+   bobjr_finish_wa(ctx);
+   wam_copy(out, ctx->state, 32);
+}
+
+void qdsa_log_init(qdsa_log *log, const uint8_t id[32])
+{
+   bobjr_ctx ctx;
+
+   log_start(&ctx, 'I');
+   bobjr_absorb_wa(&ctx, id, 32);
+   log_finish(&ctx, log->head);
+   log->n = 0;
+}
+
+void qdsa_log_append(qdsa_log *log, const uint8_t *rec, size_t len)
+{
+   uint32_t _align4 w[2] = { log->n, (uint32_t)len };
+   bobjr_ctx ctx;
+
+   log_start(&ctx, 'R');
+   bobjr_absorb_wa(&ctx, (const uint8_t *)log->head, 32);
+   bobjr_absorb_wa(&ctx, (const uint8_t *)w, 8);
+   log_absorb(&ctx, rec, len);
+   log_finish(&ctx, log->head);
+   log->n++;
+}
+
+/* The message a checkpoint signs. */
+static void log_msg(uint32_t *msg, const qdsa_log *log)
+{
+   bobjr_ctx ctx;
+
+   log_start(&ctx, 'C');
+   bobjr_absorb_wa(&ctx, (const uint8_t *)&log->n, 4);
+   bobjr_absorb_wa(&ctx, (const uint8_t *)log->head, 32);
+   log_finish(&ctx, msg);
+}
+
+int qdsa_log_verify(const uint8_t sig[64], const uint8_t pk[32],
+   const qdsa_log *from, const uint8_t *const rec[], const size_t len[],
+   size_t n)
+{
+   qdsa_log log = *from;
+   uint32_t msg[8];
+
+   for (size_t i = 0; i < n; i++)
+      qdsa_log_append(&log, rec[i], len[i]);
+   log_msg(msg, &log);
+   return qdsa_verify(sig, pk, (const uint8_t *)msg);
+}
+
+#if CONF_QDSA_FULL
+int qdsa_log_checkpoint(uint8_t sig[64], const qdsa_log *log,
+   const uint8_t pk[32], const uint8_t sk[64])
+{
+   uint32_t msg[8];
+
+   log_msg(msg, log);
+   return qdsa_sign(sig, (const uint8_t *)msg, pk, sk);
+}
+#endif
+#endif  // CONF_QDSA_LOG
+
+#if CONF_QDSA_TUNE
+/* -----------------------------------------------------------------------------
+ * Host autotuner. Each timing is the median of TUNE_RUNS samples. A batch
+ * chunk of m goes to the lanes once m single calls cost more than one call on
+ * all lanes, and pairs go to the two-way sponge if it beats two hashes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TUNE_RUNS 7
+#define TUNE_NL (CONF_QDSA_LANES ? CONF_QDSA_LANES : 1)
+#define TUNE_FORMAT 1
+#define TUNE_BUILD (TUNE_FORMAT << 16 | CONF_QDSA_SLOWMUL << 12 \
+   | CONF_KF800_VEC << 11 | CONF_QDSA_TINY << 10 | CONF_QDSA_XPK << 9 \
+   | CONF_BOBJR_X2 << 8 | CONF_QDSA_LANES)
+
+static const char *const tune_names[QDSA_TM_NUM] = { "fe_mul", "fe_mul_x",
+   "hash", "hash_x2", "keygen", "keygen_x", "dh", "dh_x", "verify",
+   "pk_expand", "verify_xpk" };
+
+/* Operands of the timed calls. */
+static struct {
+   fe1271 x, y;
+#if CONF_QDSA_LANES
+   fe1271x xx, xy;
+#endif
+   bobjr_ctx c0, c1;
+   uint8_t _align4 sk[TUNE_NL][32], pk[TUNE_NL][32], ss[TUNE_NL][32];
+   uint8_t _align4 vpk[32], vsk[64], sig[64], msg[32];
+#if CONF_QDSA_XPK
+   uint8_t _align4 xpk[QDSA_XPK_LEN];
+#endif
+} tb;
+
+static void tm_fe_mul(void)
+{
+   fe1271_mulred(&tb.x, &tb.x, &tb.y);
+}
+
+static void tm_hash(void)
+{
+   bobjr_init(&tb.c0);
+   bobjr_absorb_wa(&tb.c0, tb.sig, 64);
+   bobjr_finish_wa(&tb.c0);
+}
+
+static void tm_keygen(void)
+{
+   qdsa_dh_keygen(tb.pk[0], tb.sk[0]);
+}
+
+static void tm_dh(void)
+{
+   qdsa_dh_exchange(tb.ss[0], tb.pk[0], tb.sk[0]);
+}
+
+static void tm_verify(void)
+{
+   qdsa_verify(tb.sig, tb.vpk, tb.msg);
+}
+
+#if CONF_QDSA_LANES
+static void tm_fe_mul_x(void)
+{
+   fex_mul(&tb.xx, &tb.xx, &tb.xy);
+}
+
+static void tm_keygen_x(void)
+{
+   keygen_lanes(tb.pk, tb.sk, NL);
+}
+
+static void tm_dh_x(void)
+{
+   dh_lanes(tb.ss, tb.pk, tb.sk, NL);
+}
+#else
+#define tm_fe_mul_x NULL
+#define tm_keygen_x NULL
+#define tm_dh_x NULL
+#endif
+
+#if CONF_BOBJR_X2
+static void tm_hash_x2(void)
+{
+   bobjr_ctx2 c2;
+
+   bobjr_init2(&c2);
+   bobjr_absorb2_wa(&c2, tb.sig, tb.sig, 64);
+   bobjr_finish2_wa(&c2, &tb.c0, &tb.c1);
+}
+#else
+#define tm_hash_x2 NULL
+#endif
+
+#if CONF_QDSA_XPK
+static void tm_pk_expand(void)
+{
+   qdsa_pk_expand(tb.xpk, tb.vpk);
+}
+
+static void tm_verify_xpk(void)
+{
+   qdsa_verify_xpk(tb.sig, tb.xpk, tb.msg);
+}
+#else
+#define tm_pk_expand NULL
+#define tm_verify_xpk NULL
+#endif
+
+static double tune_now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Median ns per call of f over TUNE_RUNS samples of reps calls. */
+static double tune_time(void (*f)(void), uint reps)
+{
+   double t[TUNE_RUNS], a;
+
+   f();  // warm up
+   for (int k = 0; k < TUNE_RUNS; k++) {
+      a = tune_now();
+      for (uint i = 0; i < reps; i++)
+         f();
+      a = (tune_now() - a) / reps;
+      int j = k;
+      for (; j > 0 && t[j - 1] > a; j--)
+         t[j] = t[j - 1];
+      t[j] = a;
+   }
+   return t[TUNE_RUNS / 2];
+}
+
+/* Smallest chunk for which the lanes beat single calls; lanes+1 if none. */
+static uint32_t tune_cross(double lanes, double single)
+{
+   uint32_t m = 1;
+
+   if (lanes == 0) return 0;
+   while (m <= TUNE_NL && m * single < lanes)
+      m++;
+   return m;
+}
+
+/* CPU model from /proc/cpuinfo (x86 "model name", ARM "CPU part"), or "-". */
+static void tune_cpu(char cpu[64])
+{
+   char line[256];
+   FILE *f = fopen("/proc/cpuinfo", "r");
+
+   strcpy(cpu, "-");
+   if (!f) return;
+   while (fgets(line, sizeof(line), f)) {
+      char *v = strchr(line, ':');
+      if (!v
+         || (strncmp(line, "model name", 10) && strncmp(line, "CPU part", 8)))
+         continue;
+      v += 1 + strspn(v + 1, " \t");
+      size_t k = strcspn(v, "\n");
+      if (k > 63) k = 63;
+      memcpy(cpu, v, k);
+      cpu[k] = 0;
+      break;
+   }
+   fclose(f);
+}
+
+int qdsa_tune_run(qdsa_tune *t)
+{
+   static const struct {
+      void (*f)(void);
+      uint reps;
+   } tm[QDSA_TM_NUM] = { { tm_fe_mul, 1000 }, { tm_fe_mul_x, 1000 },
+      { tm_hash, 100 }, { tm_hash_x2, 100 }, { tm_keygen, 1 },
+      { tm_keygen_x, 1 }, { tm_dh, 1 }, { tm_dh_x, 1 }, { tm_verify, 1 },
+      { tm_pk_expand, 1 }, { tm_verify_xpk, 1 } };
+
+   memset(t, 0, sizeof(*t));
+   for (uint i = 0; i < sizeof(tb.sk); i++)
+      ((uint8_t *)tb.sk)[i] = i * 97 + 13;
+   for (uint l = 0; l < TUNE_NL; l++)
+      qdsa_dh_keygen(tb.pk[l], tb.sk[l]);
+   qdsa_keypair(tb.vpk, tb.vsk, tb.sk[0]);
+   qdsa_sign(tb.sig, tb.msg, tb.vpk, tb.vsk);
+   wam_copy(&tb.x, tb.sig, 16);
+   wam_copy(&tb.y, tb.sig + 16, 16);
+#if CONF_QDSA_LANES
+   for (uint i = 0; i < 4; i++) {
+      for (uint l = 0; l < NL; l++) {
+         tb.xx.v[i][l] = tb.x.v[i];
+         tb.xy.v[i][l] = tb.y.v[i];
+      }
+   }
+#endif
+#if CONF_QDSA_XPK
+   qdsa_pk_expand(tb.xpk, tb.vpk);
+#endif
+
+   for (int k = 0; k < QDSA_TM_NUM; k++) {
+      if (tm[k].f) t->ns[k] = tune_time(tm[k].f, tm[k].reps);
+   }
+
+   t->build = TUNE_BUILD;
+   tune_cpu(t->cpu);
+   t->lanes_base = tune_cross(t->ns[QDSA_TM_KEYGEN_X], t->ns[QDSA_TM_KEYGEN]);
+   t->lanes_dh = tune_cross(t->ns[QDSA_TM_DH_X], t->ns[QDSA_TM_DH]);
+   t->x2 = t->ns[QDSA_TM_HASH_X2] > 0
+      && t->ns[QDSA_TM_HASH_X2] < 2 * t->ns[QDSA_TM_HASH];
+   // k verifies cost k*v plain and e + k*vx expanded.
+   double gain = t->ns[QDSA_TM_VERIFY] - t->ns[QDSA_TM_VERIFY_XPK];
+   if (t->ns[QDSA_TM_VERIFY_XPK] && gain > 0)
+      t->xpk_min = (uint32_t)(t->ns[QDSA_TM_PK_EXPAND] / gain) + 1;
+   wam_zero(tb.vsk, sizeof(tb.vsk));
+   return 0;
+}
+
+void qdsa_tune_get(qdsa_tune *t)
+{
+   *t = tune;
+}
+
+void qdsa_tune_set(const qdsa_tune *t)
+{
+   tune = *t;
+}
+
+int qdsa_tune_save(const qdsa_tune *t, const char *path)
+{
+   FILE *f = strcmp(path, "-") ? fopen(path, "w") : stdout;
+
+   if (!f) return 1;
+   fprintf(f, "# qDSA tune profile; timings in ns, medians of %d runs\n",
+      TUNE_RUNS);
+   fprintf(f, "build %#x\ncpu %s\n", t->build, t->cpu);
+   fprintf(f, "lanes_base %u\nlanes_dh %u\nx2 %u\nxpk_min %u\n",
+      t->lanes_base, t->lanes_dh, t->x2, t->xpk_min);
+   for (int k = 0; k < QDSA_TM_NUM; k++)
+      fprintf(f, "%s %.1f\n", tune_names[k], t->ns[k]);
+   int err = ferror(f);
+   if (f == stdout)
+      err |= fflush(f);
+   else
+      err |= fclose(f);
+   return err != 0;
+}
+
+/* Returns 1 also for a profile of another build or CPU; t is filled anyway. */
+int qdsa_tune_load(qdsa_tune *t, const char *path)
+{
+   char line[128], cpu[64];
+   FILE *f = fopen(path, "r");
+
+   if (!f) return 1;
+   memset(t, 0, sizeof(*t));
+   while (fgets(line, sizeof(line), f)) {
+      char *v = strchr(line, ' ');
+      if (line[0] == '#' || !v) continue;
+      *v++ = 0;
+      v[strcspn(v, "\n")] = 0;
+      if (!strcmp(line, "build"))
+         t->build = strtoul(v, NULL, 0);
+      else if (!strcmp(line, "cpu"))
+         snprintf(t->cpu, sizeof(t->cpu), "%.63s", v);
+      else if (!strcmp(line, "lanes_base"))
+         t->lanes_base = strtoul(v, NULL, 0);
+      else if (!strcmp(line, "lanes_dh"))
+         t->lanes_dh = strtoul(v, NULL, 0);
+      else if (!strcmp(line, "x2"))
+         t->x2 = strtoul(v, NULL, 0);
+      else if (!strcmp(line, "xpk_min"))
+         t->xpk_min = strtoul(v, NULL, 0);
+      for (int k = 0; k < QDSA_TM_NUM; k++) {
+         if (!strcmp(line, tune_names[k])) t->ns[k] = strtod(v, NULL);
+      }
+   }
+   fclose(f);
+   tune_cpu(cpu);
+   return t->build != TUNE_BUILD || strcmp(t->cpu, cpu);
+}
+
+int qdsa_tune_init(const char *path)
+{
+   qdsa_tune t;
+   int err = 0;
+
+   if (qdsa_tune_load(&t, path)) {
+      qdsa_tune_run(&t);
+      err = qdsa_tune_save(&t, path);
+   }
+   qdsa_tune_set(&t);
+   return err;
+}
+#endif  // CONF_QDSA_TUNE
+
 /* vim: set syn=c cin et sw=3 ts=3 tw=80 fo=cjMmnoqr: */
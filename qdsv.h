@@ -12,6 +12,8 @@
 #define QDSA_SIG_LEN 64
 #define QDSA_PK_LEN 32
 #define QDSA_MSG_LEN 32
+#define QDSA_XPK_LEN 144
+#define QDSA_XTAB_LEN 32256
 
 /*
  * Return 0 if verification passed successfully.
@@ -23,6 +25,135 @@
 int qdsa_verify(
    const uint8_t sig[64], const uint8_t pk[32], const uint8_t msg[32]);
 
+/*
+ * Optional; see CONF_QDSA_H128 in C. H128 (v1) signatures use a 128-bit
+ * challenge and are not interchangeable with the regular ones.
+ */
+int qdsa_verify_h128(
+   const uint8_t sig[64], const uint8_t pk[32], const uint8_t msg[32]);
+int qdsa_sign_h128(uint8_t sig[64], const uint8_t msg[32],
+   const uint8_t pk[32], const uint8_t sk[64]);
+
+/*
+ * Optional; see CONF_QDSA_XPK in C. Expand a public key once, then verify with
+ * the expanded key. Return 0 on success, 1 if pk is not a valid point.
+ */
+int qdsa_pk_expand(uint8_t xpk[144], const uint8_t pk[32]);
+int qdsa_verify_xpk(
+   const uint8_t sig[64], const uint8_t xpk[144], const uint8_t msg[32]);
+
+/*
+ * Optional; see CONF_QDSA_XTAB in C. Fixed-base table of an expanded key for
+ * the [h]Q half of verify. Return 0 on success, 1 if the key has no table;
+ * qdsa_verify_xpk() still works for it.
+ */
+int qdsa_pk_table(uint8_t tab[QDSA_XTAB_LEN], const uint8_t xpk[144]);
+int qdsa_verify_xtab(const uint8_t sig[64], const uint8_t xpk[144],
+   const uint8_t tab[QDSA_XTAB_LEN], const uint8_t msg[32]);
+
+/*
+ * Optional; see CONF_QDSA_BUNDLE in C. All-or-nothing verify of n signatures:
+ * workers verify disjoint ranges [from, to) with one shared qdsa_bundle, and
+ * the first failure makes the others give up early. Return 0 only if every
+ * item of the range passed and no other worker failed; after 1, fail holds
+ * the lowest failing index found, plus one.
+ */
+typedef struct {
+   volatile uint32_t fail;
+} qdsa_bundle;
+void qdsa_bundle_init(qdsa_bundle *b);
+int qdsa_verify_bundle(qdsa_bundle *b, const uint8_t sig[][64],
+   const uint8_t pk[][32], const uint8_t msg[][32], size_t from, size_t to);
+
+/*
+ * Optional; see CONF_QDSA_SCHED in C. Two-class verify queue. A QDSA_LAT
+ * request is served alone as soon as a worker is free, before any bulk work;
+ * QDSA_BULK requests are taken in batches of up to batch (at most
+ * QDSA_SCHED_MAX) and grouped by key, so each key of a batch is decompressed
+ * once. Workers with an index below reserved serve only QDSA_LAT. The caller
+ * provides ring space for 2*cap requests, cap a power of 2, and submits each
+ * class from one thread; submit returns 1 if that class is full. Any number
+ * of threads call work with their worker index; it returns how many requests
+ * it served, 0 if none was waiting. Times are CLOCK_MONOTONIC ns: t_in is set
+ * by submit unless nonzero, t_start and t_done by the worker. res is -1 until
+ * done, then the result of qdsa_verify.
+ */
+#define QDSA_SCHED_MAX 64
+enum { QDSA_LAT, QDSA_BULK };
+typedef struct {
+   const uint8_t *sig, *pk, *msg;
+   uint64_t t_in, t_start, t_done;
+   int cls;
+   volatile int res;
+} qdsa_req;
+typedef struct {
+   qdsa_req **ring[2];
+   uint32_t mask, batch, reserved;
+   volatile uint32_t head[2], tail[2];
+} qdsa_sched;
+void qdsa_sched_init(qdsa_sched *s, qdsa_req **ring, unsigned cap,
+   unsigned batch, unsigned reserved);
+int qdsa_sched_submit(qdsa_sched *s, qdsa_req *r);
+unsigned qdsa_sched_work(qdsa_sched *s, unsigned w);
+
+/*
+ * Optional; see CONF_QDSA_STREAM in C. Verify an image while copying it, e.g.
+ * from external to internal flash or RAM: each copy call moves len bytes from
+ * src to dst and hashes them on the way, so src is read once. The message is
+ * the Bob Jr. hash of the whole image, and the stream is used up by verify.
+ * Lengths are whole words.
+ */
+typedef struct {
+   uint32_t ptr;
+   uint32_t state[25];
+} qdsa_stream;
+void qdsa_stream_init(qdsa_stream *s);
+void qdsa_stream_copy(qdsa_stream *s, void *dst, const void *src, size_t len);
+int qdsa_stream_verify(
+   qdsa_stream *s, const uint8_t sig[64], const uint8_t pk[32]);
+
+/*
+ * Optional; see CONF_QDSA_DIGEST in C. Hash an image to the 32-byte message.
+ * Return 0, or -1 if the version is unknown.
+ */
+#define QDSA_DIGEST_TS128 1  // TurboSHAKE128, D=0x1f.
+int qdsa_digest(uint8_t md[32], const uint8_t *img, size_t len, int ver);
+
+/*
+ * Optional; see CONF_QDSA_LOG in C. Signed log: append() chains each record
+ * (any length, word-aligned) into the head, checkpoint() signs the head and
+ * count, and verify() checks n records from a saved state of the log against
+ * a checkpoint with one qdsa_verify. Return 0 on success.
+ */
+typedef struct {
+   uint32_t n;        // records so far
+   uint32_t head[8];  // chain head
+} qdsa_log;
+void qdsa_log_init(qdsa_log *log, const uint8_t id[32]);
+void qdsa_log_append(qdsa_log *log, const uint8_t *rec, size_t len);
+int qdsa_log_checkpoint(uint8_t sig[64], const qdsa_log *log,
+   const uint8_t pk[32], const uint8_t sk[64]);
+int qdsa_log_verify(const uint8_t sig[64], const uint8_t pk[32],
+   const qdsa_log *from, const uint8_t *const rec[], const size_t len[],
+   size_t n);
+
+/*
+ * Optional; see CONF_QDSA_PROF in C. Cycles spent in each phase of verify,
+ * sign and DH calls, summed since the last reset.
+ */
+enum {
+   QDSA_PH_DECOMPRESS,   // decompress pk
+   QDSA_PH_WRAP,         // xWRAP of pk
+   QDSA_PH_SCALAR,       // hashing and mod-N arithmetic
+   QDSA_PH_LADDER,       // variable-base Ladder: [h]Q, DH exchange
+   QDSA_PH_LADDER_BASE,  // fixed-base Ladder: [s]P, [r]P, keygen
+   QDSA_PH_CHECK,        // final check of verify
+   QDSA_PH_COMPRESS,     // compress the result point
+   QDSA_PH_NUM
+};
+void qdsa_prof_get(uint64_t cyc[QDSA_PH_NUM]);
+void qdsa_prof_reset(void);
+
 /*
  * Following are optional; see CONF_QDSA_FULL in C.
  */
@@ -33,6 +164,83 @@ int qdsa_dh_keygen(uint8_t pk[32], const uint8_t sk[32]);
 int qdsa_dh_exchange(
    uint8_t ss[32], const uint8_t pk[32], const uint8_t sk[32]);
 
+/*
+ * Optional; see CONF_QDSA_DHC in C. qdsa_dh_exchange with a cache of shared
+ * secrets in caller-provided entries, keyed by the peer pk and an id of the
+ * local secret key; kid must identify sk uniquely. The least recently used
+ * entry is evicted. Evicted and dropped entries are zeroed; drop with pk NULL
+ * drops all entries of a local key, e.g. when it is retired. A pk that does not
+ * decompress returns 1 and is not stored. Not thread-safe.
+ */
+typedef struct {
+   uint32_t pk[8];  // peer public key
+   uint32_t ss[8];  // shared secret
+   uint32_t kid;    // local key id
+   uint32_t used;   // last use, 0 if free
+} qdsa_dh_entry;
+typedef struct {
+   qdsa_dh_entry *e;
+   uint32_t n, tick;
+   uint32_t hits, misses;
+} qdsa_dh_cache;
+void qdsa_dh_cache_init(qdsa_dh_cache *c, qdsa_dh_entry *e, unsigned n);
+int qdsa_dh_exchange_cached(qdsa_dh_cache *c, uint8_t ss[32],
+   const uint8_t pk[32], const uint8_t sk[32], uint32_t kid);
+void qdsa_dh_cache_drop(qdsa_dh_cache *c, const uint8_t pk[32], uint32_t kid);
+void qdsa_dh_cache_clear(qdsa_dh_cache *c);
+
+/*
+ * Batch versions of the above for n independent calls; see CONF_QDSA_LANES in
+ * C. Results are the same as n single calls.
+ */
+int qdsa_keypair_batch(uint8_t pk[][32], uint8_t sk[][64],
+   const uint8_t seed[][32], unsigned n);
+int qdsa_sign_batch(uint8_t sig[][64], const uint8_t msg[][32],
+   const uint8_t pk[][32], const uint8_t sk[][64], unsigned n);
+int qdsa_dh_keygen_batch(uint8_t pk[][32], const uint8_t sk[][32], unsigned n);
+int qdsa_dh_exchange_batch(uint8_t ss[][32], const uint8_t pk[][32],
+   const uint8_t sk[][32], unsigned n);
+
+/*
+ * Optional; see CONF_QDSA_TUNE in C. Host profile: crossover points of the
+ * batch calls and the timings they come from, in ns (medians). The profile
+ * file is text, one "name value" per line; "-" saves to stdout. init loads
+ * the profile from path, or measures and saves it if the file is missing or
+ * was made by another build or CPU, and applies it. Apply before batch calls
+ * run on other threads. All return 0 on success.
+ */
+enum {
+   QDSA_TM_FE_MUL,      // field multiplication
+   QDSA_TM_FE_MUL_X,    // field multiplication in all lanes
+   QDSA_TM_HASH,        // Bob Jr. of 64B
+   QDSA_TM_HASH_X2,     // two-way Bob Jr. of 2x64B
+   QDSA_TM_KEYGEN,      // qdsa_dh_keygen: fixed-base Ladder
+   QDSA_TM_KEYGEN_X,    // qdsa_dh_keygen_batch for all lanes
+   QDSA_TM_DH,          // qdsa_dh_exchange: variable-base Ladder
+   QDSA_TM_DH_X,        // qdsa_dh_exchange_batch for all lanes
+   QDSA_TM_VERIFY,      // qdsa_verify
+   QDSA_TM_PK_EXPAND,   // qdsa_pk_expand
+   QDSA_TM_VERIFY_XPK,  // qdsa_verify_xpk
+   QDSA_TM_NUM
+};
+typedef struct {
+   uint32_t build;          // switches of the build that measured it
+   uint32_t lanes_base;     // keygen and sign chunks of this many or more
+                            // go to the lanes; lanes+1: never
+   uint32_t lanes_dh;       // the same for DH exchange
+   uint32_t x2;             // hash pairs with the two-way sponge
+   uint32_t xpk_min;        // verifies of one key from which expanding it
+                            // pays; 0: never. Advice for the caller.
+   double ns[QDSA_TM_NUM];  // 0 where the build lacks the path
+   char cpu[64];
+} qdsa_tune;
+int qdsa_tune_run(qdsa_tune *t);
+void qdsa_tune_get(qdsa_tune *t);
+void qdsa_tune_set(const qdsa_tune *t);
+int qdsa_tune_load(qdsa_tune *t, const char *path);
+int qdsa_tune_save(const qdsa_tune *t, const char *path);
+int qdsa_tune_init(const char *path);
+
 #endif /* QDSV_H_ */
 
 /* vim: set syn=c cin et sw=3 ts=3 tw=80 fo=cjMmnoqr: */
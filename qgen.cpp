@@ -0,0 +1,497 @@
+/*
+ * qgen.cpp
+ *
+ * Generates qconst.h, the precomputed constants of qdsv.c, at compile time
+ * from the Kummer parameters (mu, muhat, C) and the wrapped base point:
+ *
+ *      e_cons, ehat    prod(m)/m_i over their gcd, for m = mu, muhat
+ *      bijc            folded B_ij constants, see qdsv.c
+ *      jf, jM, jMi     curve and Kummer maps of CONF_QDSA_XTAB, see below
+ *
+ * fe1271 and the Kummer operations are constexpr ports of qdsv.c (same
+ * Hadamard, xDBLADD, ladder, sign conventions) on canonical residues. As a
+ * self-check, [N+1]B must come back as the wrapped base point.
+ *
+ * Build: g++ -std=c++17 -o qgen qgen.cpp && ./qgen > qconst.h
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+typedef unsigned __int128 u128;
+
+/* -----------------------------------------------------------------------------
+ * Fp = 2^127-1, canonical (< p).
+ */
+struct fe {
+   u128 v;
+};
+
+constexpr u128 P = ((u128)1 << 127) - 1;
+
+constexpr fe fold(u128 x)  // any 128 bits
+{
+   x = (x & P) + (x >> 127);
+   return { x == P ? 0 : x };
+}
+
+constexpr fe set(uint64_t x) { return fold(x); }
+constexpr fe add(fe x, fe y) { return fold(x.v + y.v); }
+constexpr fe sub(fe x, fe y) { return fold(x.v + (P - y.v)); }
+constexpr fe neg(fe x) { return fold(P - x.v); }
+constexpr bool eq(fe x, fe y) { return x.v == y.v; }
+
+constexpr fe mul(fe x, fe y)
+{
+   uint64_t x0 = (uint64_t)x.v, x1 = (uint64_t)(x.v >> 64);
+   uint64_t y0 = (uint64_t)y.v, y1 = (uint64_t)(y.v >> 64);
+   u128 lo = (u128)x0 * y0, hi = (u128)x1 * y1;
+   u128 m = (u128)x0 * y1 + (u128)x1 * y0;  // < 2^127 each, no overflow
+   u128 t = lo + (m << 64);
+   hi += (m >> 64) + (t < lo);
+   // x*y = hi*2^128 + t = 2*hi + t mod p, with hi < 2^126.
+   return add(fold(t), fold(hi << 1));
+}
+
+constexpr fe sqr(fe x) { return mul(x, x); }
+
+constexpr fe invert(fe x)  // x^(p-2)
+{
+   fe r = set(1);
+   for (int i = 126; i >= 0; i--) {
+      r = sqr(r);
+      if (i != 1) r = mul(r, x);
+   }
+   return r;
+}
+
+/* -----------------------------------------------------------------------------
+ * Kummer, as in qdsv.c.
+ */
+struct kpoint {
+   fe X, Y, Z, T;
+};
+
+constexpr std::array<uint64_t, 4> mu = { 0x0b, 0x16, 0x13, 0x03 };
+constexpr std::array<uint64_t, 4> muhat = { 0x21, 0x0b, 0x11, 0x31 };
+constexpr fe C = { ((u128)0x40f50eefa320a2ddull << 64) | 0x46f7e3d8cddda843ull };
+
+// Order of the base point.
+constexpr std::array<uint32_t, 8> N = { 0x7BF3FA43, 0xB88CF4B4, 0x65EAB00,
+   0x2D3D8036, 0xDF38AD6B, 0xFCCB2967, 0xFFFFFFFF, 0x3FFFFFF };
+
+constexpr kpoint from_words(const uint32_t (&w)[12])
+{
+   kpoint r {};
+   fe *c[3] = { &r.Y, &r.Z, &r.T };
+   for (int i = 0; i < 3; i++)
+      *c[i] = fold((u128)w[4 * i] | (u128)w[4 * i + 1] << 32
+         | (u128)w[4 * i + 2] << 64 | (u128)w[4 * i + 3] << 96);
+   return r;
+}
+
+// Wrapped base point (Y, Z, T).
+constexpr kpoint bpw = from_words({ 0x4e931a48, 0xaeb351a6, 0x2049c2e7,
+   0x1be0c3dc, 0xe07e36df, 0x64659818, 0x8eaba630, 0x23b416cd, 0x7215441e,
+   0xc7ae3d05, 0x4447a24d, 0x5db35c38 });
+
+constexpr uint64_t gcd(uint64_t a, uint64_t b) { return b ? gcd(b, a % b) : a; }
+
+constexpr std::array<uint16_t, 4> econst(const std::array<uint64_t, 4> &m)
+{
+   std::array<uint16_t, 4> e {};
+   uint64_t prod = m[0] * m[1] * m[2] * m[3], g = 0;
+   for (int i = 0; i < 4; i++)
+      g = gcd(g, prod / m[i]);
+   for (int i = 0; i < 4; i++)
+      e[i] = prod / m[i] / g;
+   return e;
+}
+
+constexpr std::array<uint16_t, 4> e_cons = econst(mu);
+constexpr std::array<uint16_t, 4> ehat = econst(muhat);
+
+constexpr kpoint hdmrd(kpoint x)
+{
+   fe c = add(x.X, x.Y), a = sub(x.Y, x.X), b = add(x.Z, x.T);
+   fe d = sub(x.Z, x.T);
+   return { add(a, b), sub(a, b), sub(d, c), add(c, d) };
+}
+
+constexpr kpoint mul4(kpoint x, kpoint y)
+{
+   return { mul(x.X, y.X), mul(x.Y, y.Y), mul(x.Z, y.Z), mul(x.T, y.T) };
+}
+
+constexpr kpoint mul4_const(kpoint x, const std::array<uint16_t, 4> &c)
+{
+   return { mul(x.X, set(c[0])), mul(x.Y, set(c[1])), mul(x.Z, set(c[2])),
+      mul(x.T, set(c[3])) };
+}
+
+constexpr void xDBLADD(kpoint &xp, kpoint &xq, const kpoint &xd)
+{
+   xq = hdmrd(xq);
+   xp = hdmrd(xp);
+   xq = mul4(xq, xp);
+   xp = mul4(xp, xp);
+   xq = hdmrd(mul4_const(xq, ehat));
+   xp = hdmrd(mul4_const(xp, ehat));
+   xq = mul4(xq, xq);
+   xp = mul4(xp, xp);
+   xq = { xq.X, mul(xq.Y, xd.Y), mul(xq.Z, xd.Z), mul(xq.T, xd.T) };
+   xp = mul4_const(xp, e_cons);
+}
+
+constexpr kpoint xUNWRAP(const kpoint &w)
+{
+   fe t = mul(w.Y, w.Z);
+   return { mul(t, w.T), mul(w.Z, w.T), mul(w.Y, w.T), t };
+}
+
+constexpr kpoint xWRAP(const kpoint &x)
+{
+   fe w0 = mul(x.Y, x.Z), w1 = mul(w0, x.T);
+   fe w2 = mul(invert(w1), x.X), w3 = mul(w2, x.T);
+   return { set(0), mul(w3, x.Z), mul(w3, x.Y), mul(w0, w2) };
+}
+
+/* n*B and (n+1)*B for an nb-bit scalar n of 32-bit words, wrapped. */
+template <size_t W>
+constexpr std::array<kpoint, 2> ladder_base(
+   const std::array<uint32_t, W> &n, int nb)
+{
+   kpoint xp = { set(mu[0]), set(mu[1]), set(mu[2]), set(mu[3]) };
+   kpoint xq = xUNWRAP(bpw);
+   int bit = 0, prevbit = 0;
+
+   for (int i = nb - 1; i >= 0; i--) {
+      bit = (n[i >> 5] >> (i & 31)) & 1;
+      xq.X = neg(xq.X);
+      if (bit ^ prevbit) {
+         kpoint t = xp;
+         xp = xq;
+         xq = t;
+      }
+      prevbit = bit;
+      xDBLADD(xp, xq, bpw);
+   }
+   xp.X = neg(xp.X);
+   if (bit) {
+      kpoint t = xp;
+      xp = xq;
+      xq = t;
+   }
+   return { xWRAP(xp), xWRAP(xq) };
+}
+
+constexpr bool same_wrapped(const kpoint &x, const kpoint &y)
+{
+   return eq(x.Y, y.Y) && eq(x.Z, y.Z) && eq(x.T, y.T);
+}
+
+static_assert(same_wrapped(ladder_base(N, 251)[1], bpw), "[N+1]B != B");
+
+/* -----------------------------------------------------------------------------
+ * Tables.
+ */
+struct bijconst {
+   fe K;
+   uint16_t c34, c1234;
+};
+
+constexpr std::array<bijconst, 6> bij_table()
+{
+   // (c1,c2) index pairs for B12, B13, B14, B23, B24, B34; (c3,c4) the rest.
+   constexpr int ij[6][4] = { { 0, 1, 2, 3 }, { 0, 2, 1, 3 }, { 0, 3, 1, 2 },
+      { 1, 2, 0, 3 }, { 1, 3, 0, 2 }, { 2, 3, 0, 1 } };
+   std::array<bijconst, 6> r {};
+
+   for (int k = 0; k < 6; k++) {
+      uint64_t c1 = muhat[ij[k][0]], c2 = muhat[ij[k][1]];
+      uint64_t c3 = muhat[ij[k][2]], c4 = muhat[ij[k][3]];
+      fe K = mul(add(C, C), set(c1 * c2));
+      K = mul(K, set(c2 * c4 + c1 * c3));
+      K = mul(K, set(c2 * c3 + c1 * c4));
+      r[k] = { k < 3 ? K : neg(K), (uint16_t)(c3 * c4),
+         (uint16_t)(c1 * c2 + c3 * c4) };
+   }
+   return r;
+}
+
+constexpr std::array<bijconst, 6> bijc = bij_table();
+
+/* -----------------------------------------------------------------------------
+ * Jacobian behind the Kummer, for the fixed-base tables of CONF_QDSA_XTAB: the
+ * Rosenhain curve
+ *
+ *      C: y^2 = f(x) = x(x-1)(x-l)(x-m)(x-n)
+ *
+ * of the theta constants (a,b,c,d) = (11,-22,19,3), (A,B,C,D) = (33,11,17,-49)
+ * (mu and muhat with the Ladder's signs): alpha^2 = CD/AB = -833/363, so
+ * alpha = 7s/33 with s = sqrt(-51), and
+ *
+ *      l = ac/bd,  m = c(1+alpha)/d(1-alpha),  n = a(1+alpha)/b(1-alpha).
+ *
+ * s = (-51)^((p+1)/4) is the root for which #J(C) = 16N.
+ *
+ * A reduced divisor (u, v), u = x^2 + u1 x + u0, has Cassels-Flynn Kummer
+ * coordinates
+ *
+ *      xi = (dd, s dd, q dd, F0(s,q) - 2 y1 y2),  s = -u1, q = u0,
+ *      dd = u1^2 - 4 u0,  y1 y2 = v1^2 u0 - v1 v0 u1 + v0^2,
+ *      F0 = f1 s + 2 f2 q + f3 q s + 2 f4 q^2 + q^2 s,
+ *
+ * (0 : 1 : x1 : x1^2) for x - x1 and (0 : 0 : 0 : 1) for the identity. jM takes
+ * xi to the Kummer of the Ladder; it is fixed by the images of five 2-torsion
+ * points, identity and nodes, below. As a self-check, all 16 nodes of xi must
+ * map to nodes.
+ */
+typedef std::array<fe, 4> vec4;
+typedef std::array<vec4, 4> mat4;
+
+constexpr fe frac(int64_t n, int64_t d)
+{
+   fe r = mul(set(n < 0 ? -n : n), invert(set(d < 0 ? -d : d)));
+   return (n < 0) != (d < 0) ? neg(r) : r;
+}
+
+constexpr fe sqrt51()  // (-51)^(2^125)
+{
+   fe r = neg(set(51));
+   for (int i = 0; i < 125; i++)
+      r = sqr(r);
+   return r;
+}
+
+constexpr fe s51 = sqrt51();
+constexpr fe alpha = mul(mul(set(7), s51), invert(set(33)));
+constexpr fe ef = mul(add(set(1), alpha), invert(sub(set(1), alpha)));
+
+// Roots of f: 0, 1, l, m, n.
+constexpr std::array<fe, 5> roots = { set(0), set(1), frac(11 * 19, -22 * 3),
+   mul(frac(19, 3), ef), mul(frac(11, -22), ef) };
+
+constexpr std::array<fe, 6> fpoly()  // f0..f5
+{
+   std::array<fe, 6> f = { set(1) };
+   for (int i = 0; i < 5; i++) {
+      for (int k = i + 1; k > 0; k--)
+         f[k] = sub(f[k - 1], mul(roots[i], f[k]));
+      f[0] = neg(mul(roots[i], f[0]));
+   }
+   return f;
+}
+
+constexpr std::array<fe, 6> fc = fpoly();
+
+static_assert(eq(fc[5], set(1)) && eq(fc[0], set(0)), "f not monic with f0 = 0");
+
+constexpr fe F0(fe s, fe q)
+{
+   fe qq = sqr(q), r = mul(fc[1], s);
+   r = add(r, mul(add(fc[2], fc[2]), q));
+   r = add(r, mul(fc[3], mul(q, s)));
+   r = add(r, mul(add(fc[4], fc[4]), qq));
+   return add(r, mul(qq, s));
+}
+
+// xi of the 2-torsion point u = (x - e1)(x - e2), v = 0.
+constexpr vec4 xi2(fe e1, fe e2)
+{
+   fe s = add(e1, e2), q = mul(e1, e2);
+   fe dd = sub(sqr(s), add(add(q, q), add(q, q)));
+   return { dd, mul(s, dd), mul(q, dd), F0(s, q) };
+}
+
+constexpr vec4 xi1(fe e) { return { set(0), set(1), e, sqr(e) }; }
+
+constexpr vec4 xi0 = { set(0), set(0), set(0), set(1) };
+
+// Identity of the Ladder, (-mu1 : mu2 : mu3 : mu4), under a Klein permutation.
+constexpr vec4 kid(int a, int b, int c, int d)
+{
+   vec4 m = { neg(set(mu[0])), set(mu[1]), set(mu[2]), set(mu[3]) };
+   return { m[a], m[b], m[c], m[d] };
+}
+
+constexpr mat4 inverse(mat4 a)  // Gauss-Jordan; a must be invertible
+{
+   mat4 r {};
+   for (int i = 0; i < 4; i++)
+      r[i][i] = set(1);
+   for (int c = 0; c < 4; c++) {
+      int k = c;
+      while (eq(a[k][c], set(0)))
+         k++;
+      vec4 t0 = a[k], t1 = r[k];  // std::swap is not constexpr in C++17
+      a[k] = a[c], r[k] = r[c];
+      a[c] = t0, r[c] = t1;
+      fe t = invert(a[c][c]);
+      for (int j = 0; j < 4; j++) {
+         a[c][j] = mul(a[c][j], t);
+         r[c][j] = mul(r[c][j], t);
+      }
+      for (int i = 0; i < 4; i++) {
+         if (i == c) continue;
+         t = a[i][c];
+         for (int j = 0; j < 4; j++) {
+            a[i][j] = sub(a[i][j], mul(t, a[c][j]));
+            r[i][j] = sub(r[i][j], mul(t, r[c][j]));
+         }
+      }
+   }
+   return r;
+}
+
+constexpr vec4 apply(const mat4 &m, const vec4 &x)
+{
+   vec4 r {};
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+         r[i] = add(r[i], mul(m[i][j], x[j]));
+   return r;
+}
+
+/* The projective map taking x[0..4] to y[0..4], both in general position. */
+constexpr mat4 frame(const std::array<vec4, 5> &x, const std::array<vec4, 5> &y)
+{
+   mat4 X {}, Y {}, r {};
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++) {
+         X[i][j] = x[j][i];
+         Y[i][j] = y[j][i];
+      }
+   mat4 Xi = inverse(X);
+   vec4 cx = apply(Xi, x[4]), cy = apply(inverse(Y), y[4]);
+   for (int j = 0; j < 4; j++) {
+      fe k = mul(cy[j], invert(cx[j]));
+      for (int i = 0; i < 4; i++)
+         Y[i][j] = mul(Y[i][j], k);
+   }
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+         for (int k = 0; k < 4; k++)
+            r[i][j] = add(r[i][j], mul(Y[i][k], Xi[k][j]));
+   return r;
+}
+
+// O, x, (x - 1)(x - l), (x - m)(x - n) and x - 1 go to the identity, its
+// Klein permutations and the node (0 : 1 : 0 : (1 - 7s)/50).
+constexpr mat4 jM = frame(
+   { xi0, xi1(roots[0]), xi2(roots[1], roots[2]), xi2(roots[3], roots[4]),
+      xi1(roots[1]) },
+   { kid(0, 1, 2, 3), kid(1, 0, 3, 2), kid(3, 2, 1, 0), kid(2, 3, 0, 1),
+      { set(0), set(1), set(0),
+         mul(sub(set(1), mul(set(7), s51)), invert(set(50))) } });
+
+constexpr mat4 jMi = inverse(jM);
+
+/* A node of the Kummer: a Klein permutation of the identity or two zeros. */
+constexpr bool is_node(const vec4 &x)
+{
+   constexpr int klein[4][4] = { { 0, 1, 2, 3 }, { 1, 0, 3, 2 },
+      { 2, 3, 0, 1 }, { 3, 2, 1, 0 } };
+   int z = 0;
+   for (int i = 0; i < 4; i++)
+      z += eq(x[i], set(0));
+   if (z == 2) return true;
+   for (int k = 0; k < 4; k++) {
+      vec4 m = kid(klein[k][0], klein[k][1], klein[k][2], klein[k][3]);
+      bool prop = true;
+      for (int i = 0; i < 4; i++)
+         for (int j = i + 1; j < 4; j++)
+            prop = prop && eq(mul(x[i], m[j]), mul(x[j], m[i]));
+      if (prop) return true;
+   }
+   return false;
+}
+
+constexpr bool nodes_map()
+{
+   if (!is_node(apply(jM, xi0))) return false;
+   for (int i = 0; i < 5; i++) {
+      if (!is_node(apply(jM, xi1(roots[i])))) return false;
+      for (int j = i + 1; j < 5; j++)
+         if (!is_node(apply(jM, xi2(roots[i], roots[j])))) return false;
+   }
+   return true;
+}
+
+static_assert(nodes_map(), "jM does not map the 2-torsion to the nodes");
+
+/* -----------------------------------------------------------------------------
+ * Output.
+ */
+static void print_fe(const char *pre, fe x, const char *post)
+{
+   printf("%s{ .v = { 0x%08x, 0x%08x, 0x%08x, 0x%08x } }%s", pre,
+      (uint32_t)x.v, (uint32_t)(x.v >> 32), (uint32_t)(x.v >> 64),
+      (uint32_t)(x.v >> 96), post);
+}
+
+static void print_wrapped(const kpoint &x, const char *ind)
+{
+   printf("%s.Y = ", ind);
+   print_fe("", x.Y, ",\n");
+   printf("%s.Z = ", ind);
+   print_fe("", x.Z, ",\n");
+   printf("%s.T = ", ind);
+   print_fe("", x.T, "\n");
+}
+
+static void print_u16(const char *name, const std::array<uint16_t, 4> &c)
+{
+   printf("static const uint16_t %s[4] = { 0x%x, 0x%x, 0x%x, 0x%x };\n", name,
+      c[0], c[1], c[2], c[3]);
+}
+
+static void print_mat(const char *name, const mat4 &m)
+{
+   printf("static const fe1271 %s[4][4] = {\n", name);
+   for (int i = 0; i < 4; i++) {
+      printf("   {\n");
+      for (int j = 0; j < 4; j++)
+         print_fe("      ", m[i][j], ",\n");
+      printf("   },\n");
+   }
+   printf("};\n");
+}
+
+int main()
+{
+   static const char *bij[6] = { "B12", "B13", "B14", "B23", "B24", "B34" };
+
+   printf("/*\n * qconst.h\n *\n * Generated by qgen.cpp; do not edit.\n */\n\n");
+   for (int i = 0; i < 4; i++)
+      printf("static const uint8_t mu_%d = 0x%02x;\n", i + 1, (unsigned)mu[i]);
+   printf("static const uint16_t muhat[4] = { 0x%04x, 0x%04x, 0x%04x, 0x%04x "
+          "};\n",
+      (unsigned)muhat[0], (unsigned)muhat[1], (unsigned)muhat[2], (unsigned)muhat[3]);
+   print_u16("e_cons", e_cons);
+   print_u16("ehat", ehat);
+
+   printf("\n/* Wrapped base point. */\nstatic const kpoint bpw = {\n");
+   print_wrapped(bpw, "   ");
+   printf("};\n\n/* B_{ij} constants, see bijconst. */\n");
+   printf("static const bijconst bijc[6] = {\n");
+   for (int k = 0; k < 6; k++) {
+      printf("   // %s\n", bij[k]);
+      print_fe("   { ", bijc[k].K, "");
+      printf(", 0x%03x, 0x%03x },\n", bijc[k].c34, bijc[k].c1234);
+   }
+   printf("};\n");
+
+   printf("\n#if CONF_QDSA_XTAB\n/* f1..f4 of the curve, see jpoint. */\n");
+   printf("static const fe1271 jf[4] = {\n");
+   for (int i = 1; i < 5; i++)
+      print_fe("   ", fc[i], ",\n");
+   printf("};\n\n/* Cassels-Flynn coordinates to the Kummer, and back. */\n");
+   print_mat("jM", jM);
+   print_mat("jMi", jMi);
+   printf("#endif\n");
+   return 0;
+}
+
+/* vim: set syn=cpp cin et sw=3 ts=3 tw=80 fo=cjMmnoqr: */
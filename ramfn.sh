@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+# Size report for CONF_QDSA_RAMFUNC (hot kernels in SRAM, see supp.h).
+#
+# Builds qdsv.c and supp.c with every group in the RAM section, lists the
+# functions of each group with their sizes and picks groups in order of their
+# share of verify time (MUL, MULC, ADD, XDBLADD, KF800) as long as they fit
+# the budget. Prints the resulting -DCONF_QDSA_RAMFUNC mask.
+#
+# Usage: ./ramfn.sh [host|m0|m3|m4] [budget bytes]   (default m4 4096)
+# Extra switches for the build go in $CONF, e.g. CONF=-DCONF_QDSA_TINY.
+# ARM cores need arm-none-eabi-gcc. The section name is CONF_QDSA_RAMSECT,
+# default .ramfunc; the linker script must load it to SRAM.
+
+SRC=$(cd "$(dirname "$0")" && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+CORE=${1:-m4}
+BUDGET=${2:-4096}
+
+case $CORE in
+host) cc=${CC:-gcc} od=objdump mcpu= ;;
+m0|m3|m4)
+   cc=arm-none-eabi-gcc od=arm-none-eabi-objdump
+   [ $CORE = m0 ] && mcpu=-mcpu=cortex-m0plus || mcpu=-mcpu=cortex-$CORE
+   mcpu="$mcpu -mthumb"
+   if ! command -v $cc > /dev/null; then
+      echo "$cc not found" >&2
+      exit 1
+   fi ;;
+*) echo "unknown core $CORE" >&2; exit 1 ;;
+esac
+
+for f in qdsv supp; do
+   $cc $mcpu -Os -Wall $CONF -DCONF_QDSA_RAMFUNC=0x1f -c "$SRC/$f.c" \
+      -o "$TMP/$f.o" || exit 1
+done
+
+$od -t "$TMP/qdsv.o" "$TMP/supp.o" | awk -v budget=$BUDGET -v core=$CORE '
+function hex(s,   i, v) {
+   v = 0
+   for (i = 1; i <= length(s); i++)
+      v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+   return v
+}
+/ F \.ramfunc/ {
+   n = $NF
+   sz = hex($(NF - 1))
+   if (n ~ /^(bigint_mul|bigint_red|fe1271_mulred|fe1271_sqrred)/) g = 1
+   else if (n ~ /^fe1271_mulconst/) g = 2
+   else if (n ~ /^fe1271_(add|sub|neg|hdmrd)/) g = 3
+   else if (n ~ /^kf800_permute/) g = 5
+   else g = 4
+   size[g] += sz
+   fns[g] = fns[g] " " n "(" sz ")"
+}
+END {
+   split("MUL MULC ADD XDBLADD KF800", name)
+   printf "%s, budget %dB\n", core, budget
+   printf "%-8s %6s %6s  %s\n", "group", "bytes", "total", "functions"
+   tot = 0; mask = 0
+   for (g = 1; g <= 5; g++) {
+      fit = tot + size[g] <= budget
+      if (fit) { tot += size[g]; mask += 2 ^ (g - 1) }
+      printf "%-8s %6d %6s %s%s\n", name[g], size[g], fit ? tot : "-",
+         fit ? " " : "*", fns[g]
+   }
+   printf "-DCONF_QDSA_RAMFUNC=0x%02x: %dB in SRAM (* does not fit)\n", mask,
+      tot
+}'
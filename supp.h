@@ -29,10 +29,64 @@ typedef unsigned uint;
 #define _alfn
 #endif
 
+/*
+ * Hot kernels in SRAM for parts with flash wait states and no cache.
+ * CONF_QDSA_RAMFUNC is a mask of the QDSA_RF_* groups to put into section
+ * CONF_QDSA_RAMSECT, which the startup code must copy from flash to SRAM like
+ * .data. They are called with long calls, as SRAM is out of BL range from
+ * flash. ramfn.sh reports the group sizes against a budget.
+ */
+#define QDSA_RF_MUL 1       // bigint_mul, fe1271_mulred, fe1271_sqrred
+#define QDSA_RF_MULC 2      // fe1271_mulconst
+#define QDSA_RF_ADD 4       // fe1271_add, _sub, _neg, _hdmrd
+#define QDSA_RF_XDBLADD 8   // xDBLADD and its pairwise helpers
+#define QDSA_RF_KF800 16    // kf800_permute
+
+#ifndef CONF_QDSA_RAMFUNC
+#define CONF_QDSA_RAMFUNC 0
+#endif
+#ifndef CONF_QDSA_RAMSECT
+#define CONF_QDSA_RAMSECT ".ramfunc"
+#endif
+
+#ifdef __arm__
+#define _rf_attr \
+   __attribute__((section(CONF_QDSA_RAMSECT), noinline, long_call))
+#else
+#define _rf_attr __attribute__((section(CONF_QDSA_RAMSECT), noinline))
+#endif
+#define _ramfn(g) _rf_##g
+#if CONF_QDSA_RAMFUNC & QDSA_RF_MUL
+#define _rf_MUL _rf_attr
+#else
+#define _rf_MUL
+#endif
+#if CONF_QDSA_RAMFUNC & QDSA_RF_MULC
+#define _rf_MULC _rf_attr
+#else
+#define _rf_MULC
+#endif
+#if CONF_QDSA_RAMFUNC & QDSA_RF_ADD
+#define _rf_ADD _rf_attr
+#else
+#define _rf_ADD
+#endif
+#if CONF_QDSA_RAMFUNC & QDSA_RF_XDBLADD
+#define _rf_XDBLADD _rf_attr
+#else
+#define _rf_XDBLADD
+#endif
+#if CONF_QDSA_RAMFUNC & QDSA_RF_KF800
+#define _rf_KF800 _rf_attr
+#else
+#define _rf_KF800
+#endif
+
 /* -----------------------------------------------------------------------------
  * All lengths are in bytes, and are truncated to whole words.
  */
 void wam_copy(void *d, const void *s, uint len);
+void wam_copy2(void *d0, void *d1, const void *s, uint len);
 void wam_zero(void *w, uint len);
 void wam_fill(void *w, uint len, uint v);
 void wam_swap(void *a, void *b, uint len);
@@ -59,10 +113,93 @@ static inline void bobjr_init(bobjr_ctx *ctx)
 /* "wa" suffix denotes word aligned operations. */
 void bobjr_absorb_wa(bobjr_ctx *ctx, const uint8_t *data, uint len);
 void bobjr_finish_wa(bobjr_ctx *ctx);
+/* bobjr_absorb_wa() that also copies data to dst, reading it only once. */
+void bobjr_absorb_copy(
+   bobjr_ctx *ctx, void *dst, const uint8_t *data, uint len);
 /* Removed squeeze since we're not using it. */
 
 /* The K-f[800] permute function; might be useful. */
-void kf800_permute(uint32_t *A, uint nr);
+void _ramfn(KF800) kf800_permute(uint32_t *A, uint nr);
+
+/*
+ * Single-state vector K-f[800] using GCC/Clang vector extensions. The whole
+ * state sits in two 16-lane vectors, so it needs a two-source permute to pay
+ * off: on by default with AVX-512; with AVX2 alone it is several times slower
+ * than the C version.
+ */
+#ifndef CONF_KF800_VEC
+#ifdef __AVX512F__
+#define CONF_KF800_VEC 1
+#else
+#define CONF_KF800_VEC 0
+#endif
+#endif
+
+/* -----------------------------------------------------------------------------
+ * Two-way Bob Jr. for 64-bit hosts: two independent states share each 64-bit
+ * word, bit-interleaved (bit i of state 0 in bit 2i, of state 1 in bit 2i+1),
+ * so 32-bit rotations become 64-bit rotations by 2n and one pass of the
+ * permutation serves both. Both inputs must have the same length. Finish
+ * splits the result into two ordinary contexts.
+ */
+#ifndef CONF_BOBJR_X2
+#if UINTPTR_MAX > 0xffffffffu
+#define CONF_BOBJR_X2 1
+#else
+#define CONF_BOBJR_X2 0
+#endif
+#endif
+
+#if CONF_BOBJR_X2
+typedef struct bobjr_ctx2 {
+   uint32_t ptr;        // read/write pointer into either state.
+   uint64_t state[25];  // the 25 interleaved word pairs.
+} bobjr_ctx2;
+
+static inline void bobjr_init2(bobjr_ctx2 *ctx)
+{
+   wam_zero(ctx, sizeof(bobjr_ctx2));
+}
+
+void bobjr_absorb2_wa(
+   bobjr_ctx2 *ctx, const uint8_t *d0, const uint8_t *d1, uint len);
+void bobjr_finish2_wa(bobjr_ctx2 *ctx, bobjr_ctx *c0, bobjr_ctx *c1);
+void kf800x2_permute(uint64_t *A, uint nr);
+#endif
+
+/* -----------------------------------------------------------------------------
+ * TurboSHAKE128 for bulk digests on hosts: K-f[1600], 12 rounds, rate 168B.
+ * Byte granular, any alignment. Domain byte ds is in 0x01-0x7f (0x1f when no
+ * separation is needed); squeeze may be called repeatedly after finish.
+ */
+typedef struct ts128_ctx {
+   uint32_t ptr;        // read/write pointer into state.
+   uint64_t state[25];  // the 25 lanes Keccak state.
+} ts128_ctx;
+
+static inline void ts128_init(ts128_ctx *ctx)
+{
+   wam_zero(ctx, sizeof(ts128_ctx));
+}
+
+void ts128_absorb(ts128_ctx *ctx, const uint8_t *data, size_t len);
+void ts128_finish(ts128_ctx *ctx, uint8_t ds);
+void ts128_squeeze(ts128_ctx *ctx, uint8_t *out, size_t len);
+void kf1600_permute(uint64_t *A, uint nr);
+
+/* -----------------------------------------------------------------------------
+ * Cycle counter for the phase hooks of qdsv.c: DWT CYCCNT on Cortex-M3 and up,
+ * TSC on x86, perf_event on other Linux hosts; CONF_QDSA_PROF=2 picks
+ * perf_event on x86 too (core instead of reference cycles). It is weak, so
+ * targets without a counter, like M0, can provide one, e.g. from SysTick.
+ */
+#ifndef CONF_QDSA_PROF
+#define CONF_QDSA_PROF 0
+#endif
+
+#if CONF_QDSA_PROF
+uint32_t prof_clock(void);
+#endif
 
 #endif /* SUPP_H_ */
 
@@ -0,0 +1,239 @@
+#!/bin/sh
+#
+# Configuration sweep of the verifier.
+#
+# Builds qdsa_verify for every combination of the tradeoff switches on each
+# core and reports Flash (text of an image linked with --gc-sections and
+# qdsa_verify as the entry), peak stack (deepest call path from qdsa_verify,
+# from GCC's -fcallgraph-info=su) and a cost: on the host the thread CPU time
+# per verify in us, on ARM a static cycle count of the image from objdump.
+# Host drivers run round-robin after the builds, 7 rounds of 0.2s each, so
+# that drift of the clock rate hits all rows alike; the cost is the median of
+# the round medians. Rows marked * are on the
+# Pareto front of their core.
+#
+# Usage: ./sweep.sh [host] [m0] [m3] [m4]   (default: all)
+# ARM cores need arm-none-eabi-gcc 10 or later and are skipped without it.
+# Their cost is every instruction of the image counted once, at its
+# Cortex-M cycle count (loads 2, ldm/stm/push/pop 1+n, branches 2,
+# bl 3, umull 1 on M4 and 4 on M3, udiv 7, rest 1). It ignores loop trip
+# counts and wait states, so it only ranks rows of the same core; actual
+# cycles come from the simulator. Naked assembler functions count as 0
+# bytes of stack; the deepest of them push 40B.
+#
+# Switches: CONF_QDSA_TINY, CONF_KF800_UNROLL, CONF_KF800_FULLR,
+# CONF_QDSA_FULL (also selects the constant-time Ladder swap instead of
+# wam_swap) and CONF_XDBLADD_SHAREC.
+
+SRC=$(cd "$(dirname "$0")" && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+CFLAGS="-Os -Wall -ffunction-sections -fdata-sections -fcallgraph-info=su"
+
+# Median time of verifying a valid signature (test vector 1 of main.c).
+cat > "$TMP/drv.c" << 'EOF'
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "qdsv.h"
+
+static const uint8_t sig[64] __attribute__((aligned(4))) = { 0x85, 0xc6,
+   0xde, 0x61, 0xdf, 0x48, 0x81, 0x91, 0xb7, 0x29, 0x98, 0x47, 0x81, 0x5b,
+   0x16, 0xe4, 0xbb, 0x80, 0xaa, 0x2a, 0x1d, 0x5d, 0x78, 0x93, 0x52, 0x70,
+   0x8f, 0xd7, 0xd4, 0xf9, 0x97, 0xa7, 0xf3, 0x5c, 0x4b, 0x86, 0x00, 0x8f,
+   0xa1, 0x86, 0xe5, 0xd5, 0x2f, 0x21, 0x0d, 0x84, 0xab, 0x8b, 0xb6, 0x6f,
+   0xa2, 0x97, 0x87, 0x31, 0x24, 0xae, 0xf3, 0xb8, 0x87, 0x9f, 0x9e, 0xeb,
+   0x22, 0x02 };
+static const uint8_t pk[32] __attribute__((aligned(4))) = { 0x58, 0x75,
+   0x4e, 0x99, 0xcc, 0x62, 0xf9, 0xa7, 0x39, 0xa1, 0x79, 0xf8, 0xeb, 0xa8,
+   0x26, 0xec, 0xbd, 0xdc, 0x3e, 0x9a, 0x85, 0xc5, 0x60, 0xa8, 0x3c, 0xca,
+   0x2f, 0xe4, 0xd5, 0x40, 0xef, 0xf6 };
+static const uint8_t msg[32] __attribute__((aligned(4)));
+
+#define MAXN 100001
+
+static double t[MAXN];
+
+static int cmp(const void *a, const void *b)
+{
+   double x = *(const double *)a, y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+/* Median of verifies over argv[1] us, at least 21, after one warm-up. */
+int main(int argc, char **argv)
+{
+   struct timespec a, b;
+   double sum = 0, budget = argc > 1 ? atof(argv[1]) : 1e6;
+   int n = 0;
+
+   if (qdsa_verify(sig, pk, msg)) return 1;
+   while (n < MAXN && (n < 21 || sum < budget)) {
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &a);
+      if (qdsa_verify(sig, pk, msg)) return 1;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &b);
+      t[n] = (b.tv_sec - a.tv_sec) * 1e6 + (b.tv_nsec - a.tv_nsec) / 1e3;
+      sum += t[n++];
+   }
+   qsort(t, n, sizeof(t[0]), cmp);
+   printf("%.0f\n", t[n / 2]);
+   return 0;
+}
+EOF
+
+# Static cycle count of the image $2 for core $1; see the header.
+cycles()
+{
+   ${OBJDUMP:-arm-none-eabi-objdump} -d --no-show-raw-insn "$2" | awk -v core=$1 '
+   /^ +[0-9a-f]+:\t/ {
+      split($0, f, "\t")
+      op = f[2]; sub(/ .*/, "", op); sub(/\.[nw]$/, "", op)
+      c = 1
+      if (op ~ /^(ldm|stm|push|pop|vpush|vpop)/) {
+         r = f[3]; gsub(/[^,]/, "", r); c = 2 + length(r)
+      } else if (op ~ /^(ldr|str)/)
+         c = 2
+      else if (op ~ /^(bl|blx)$/)
+         c = 3
+      else if (op ~ /^(b|bx|cbz|cbnz|tbb|tbh)$/ || op ~ /^b(eq|ne|cs|cc|hs|lo|mi|pl|vs|vc|hi|ls|ge|lt|gt|le)$/)
+         c = 2
+      else if (op ~ /^(umull|umlal|smull|smlal)$/)
+         c = core == "m3" ? 4 : 1
+      else if (op ~ /^[us]div$/)
+         c = 7
+      s += c
+   }
+   END { print s + 0 }'
+}
+
+# Deepest stack from qdsa_verify over the call graphs in $@.
+stack()
+{
+   awk '
+   /^node:/ {
+      match($0, /title: "[^"]*"/)
+      n = substr($0, RSTART + 8, RLENGTH - 9)
+      sz[n] = match($0, /[0-9]+ bytes/) ? substr($0, RSTART) + 0 : 0
+   }
+   /^edge:/ {
+      match($0, /sourcename: "[^"]*"/)
+      s = substr($0, RSTART + 13, RLENGTH - 14)
+      match($0, /targetname: "[^"]*"/)
+      t = substr($0, RSTART + 13, RLENGTH - 14)
+      nc[s]++
+      callee[s, nc[s]] = t
+   }
+   function depth(n,   i, d, m) {
+      if (n in memo) return memo[n]
+      m = 0
+      for (i = 1; i <= nc[n]; i++)
+         if ((d = depth(callee[n, i])) > m) m = d
+      return memo[n] = sz[n] + m
+   }
+   END { print depth("qdsa_verify") }' "$@"
+}
+
+build()
+{
+   core=$1 cc=$2 mcpu=$3 k=0
+   for tiny in 0 1; do
+   for unroll in 0 1; do
+   for fullr in 0 1; do
+   for full in 0 1; do
+   for sharec in 0 1; do
+      k=$((k + 1))
+      d="$TMP/$core/$k"
+      mkdir -p "$d"
+      def="-DCONF_QDSA_TINY=$tiny -DCONF_KF800_UNROLL=$unroll"
+      def="$def -DCONF_KF800_FULLR=$fullr -DCONF_QDSA_FULL=$full"
+      def="$def -DCONF_XDBLADD_SHAREC=$sharec"
+      cfg="$tiny $unroll $fullr $full $sharec"
+      if ! $cc $mcpu $CFLAGS $def -c "$SRC/qdsv.c" -o "$d/qdsv.o" \
+         || ! $cc $mcpu $CFLAGS $def -c "$SRC/supp.c" -o "$d/supp.o"; then
+         echo "$core $cfg build-error"
+         continue
+      fi
+      if [ "$core" = host ]; then
+         lflags="-nostartfiles"
+      else
+         lflags="-nostartfiles --specs=nano.specs --specs=nosys.specs"
+      fi
+      $cc $mcpu $lflags -Wl,--gc-sections -Wl,-e,qdsa_verify \
+         -o "$d/img" "$d/qdsv.o" "$d/supp.o" || continue
+      [ "$core" = host ] && sz=size || sz=arm-none-eabi-size
+      text=$($sz "$d/img" | awk 'NR == 2 { print $1 }')
+      stk=$(stack "$d"/*.ci)
+      cost=-
+      if [ "$core" = host ]; then
+         $cc -O2 -I"$SRC" -o "$d/drv" "$TMP/drv.c" "$d/qdsv.o" "$d/supp.o" \
+            && cost=@$k
+      else
+         cost=$(cycles $core "$d/img")
+      fi
+      echo "$core $cfg $text $stk $cost"
+   done; done; done; done; done
+}
+
+[ $# -eq 0 ] && set -- host m0 m3 m4
+for core in "$@"; do
+   case $core in
+   host) build host "${CC:-gcc}" "" ;;
+   m0|m3|m4)
+      if command -v arm-none-eabi-gcc > /dev/null; then
+         [ $core = m0 ] && mcpu=cortex-m0plus || mcpu=cortex-$core
+         build $core arm-none-eabi-gcc "-mcpu=$mcpu -mthumb"
+      else
+         echo "$core: arm-none-eabi-gcc not found, skipped" >&2
+      fi ;;
+   *) echo "unknown core $core" >&2; exit 1 ;;
+   esac
+done > "$TMP/rows"
+
+# Host times: @k is replaced by the median over the rounds of driver k.
+for r in 1 2 3 4 5 6 7; do
+   for d in "$TMP"/host/*/drv; do
+      [ -x "$d" ] || continue
+      k=${d%/drv}; k=${k##*/}
+      echo "$k $("$d" 200000)"
+   done
+done > "$TMP/times"
+awk '
+FILENAME == ARGV[1] { t[$1, ++n[$1]] = $2; next }
+function med(k,   i, j, m, v, a) {
+   m = n[k]
+   for (i = 1; i <= m; i++) a[i] = t[k, i]
+   for (i = 2; i <= m; i++) {
+      v = a[i]
+      for (j = i - 1; j > 0 && a[j] + 0 > v + 0; j--) a[j + 1] = a[j]
+      a[j + 1] = v
+   }
+   return a[int((m + 1) / 2)]
+}
+$1 == "host" && $NF ~ /^@/ { $NF = med(substr($NF, 2)) }
+{ print }' "$TMP/times" "$TMP/rows" > "$TMP/rows2"
+
+# Pareto front per core over (text, stack, cost); "-" compares equal.
+awk '
+{ row[NR] = $0; n = NR; for (i = 1; i <= NF; i++) f[NR, i] = $i }
+function le(a, b) { return a == "-" || b == "-" || a + 0 <= b + 0 }
+function lt(a, b) { return a != "-" && b != "-" && a + 0 < b + 0 }
+END {
+   printf "%-5s %4s %6s %5s %4s %6s %7s %6s %8s\n", "core", "TINY", "UNROLL",
+      "FULLR", "FULL", "SHAREC", "text", "stack", "cost"
+   for (i = 1; i <= n; i++) {
+      if (f[i, 7] == "build-error") { print row[i]; continue }
+      dom = 0
+      for (j = 1; j <= n && !dom; j++) {
+         if (j == i || f[j, 1] != f[i, 1] || f[j, 7] == "build-error") continue
+         if (le(f[j, 7], f[i, 7]) && le(f[j, 8], f[i, 8]) &&
+            le(f[j, 9], f[i, 9]) && (lt(f[j, 7], f[i, 7]) ||
+            lt(f[j, 8], f[i, 8]) || lt(f[j, 9], f[i, 9])))
+            dom = 1
+      }
+      printf "%-5s %4s %6s %5s %4s %6s %7s %6s %8s%s\n", f[i, 1], f[i, 2],
+         f[i, 3], f[i, 4], f[i, 5], f[i, 6], f[i, 7], f[i, 8], f[i, 9],
+         dom ? "" : " *"
+   }
+}' "$TMP/rows2"